@@ -43,8 +43,10 @@ BOOL CEngimaMachineSimulatorDoc::OnNewDocument()
 	if (!CDocument::OnNewDocument())
 		return FALSE;
 
-	// TODO: add reinitialization code here
-	// (SDI documents will reuse this document)
+	// SDI reuses this document: drop the previous key and text.
+	m_machineState = EnigmaCore::MachineState();
+	m_bHasMachineState = FALSE;
+	m_editor = Editor(m_editor.strategy());
 
 	return TRUE;
 }
@@ -54,15 +56,25 @@ BOOL CEngimaMachineSimulatorDoc::OnNewDocument()
 
 // CEngimaMachineSimulatorDoc serialization
 
+// The document is the binary machine-state record (see EnigmaState.h) followed by the plaintext.
 void CEngimaMachineSimulatorDoc::Serialize(CArchive& ar)
 {
+	BYTE record[EnigmaCore::kMachineStateSize];
 	if (ar.IsStoring())
 	{
-		// TODO: add storing code here
+		// Until the view sets a key the record is the default one, so the file still loads.
+		EnigmaCore::EncodeState(m_bHasMachineState ? m_machineState : EnigmaCore::MachineState(), record);
+		ar.Write(record, sizeof(record));
+		ar << CString(GetPlainText().str().c_str(), (int)GetPlainText().size());
 	}
 	else
 	{
-		// TODO: add loading code here
+		if (ar.Read(record, sizeof(record)) != sizeof(record) || !EnigmaCore::DecodeState(record, m_machineState))
+			AfxThrowArchiveException(CArchiveException::badSchema, ar.m_strFileName);
+		m_bHasMachineState = TRUE;
+		CString text;
+		ar >> text;
+		m_editor.load(TextModel::String(text.GetString(), (size_t)text.GetLength()));
 	}
 }
 
@@ -136,3 +148,41 @@ void CEngimaMachineSimulatorDoc::Dump(CDumpContext& dc) const
 
 
 // CEngimaMachineSimulatorDoc commands
+
+void CEngimaMachineSimulatorDoc::SetMachineState(const EnigmaCore::MachineState& state)
+{
+	if (m_bHasMachineState && memcmp(&m_machineState, &state, sizeof(state)) == 0)
+		return;
+	m_machineState = state;
+	m_bHasMachineState = TRUE;
+	SetModifiedFlag();
+}
+
+CEngimaMachineSimulatorDoc::TextEdit CEngimaMachineSimulatorDoc::EditPlainText(const TextEdit& edit)
+{
+	if (edit.empty())
+		return TextEdit();
+	SetModifiedFlag();
+	return m_editor.edit(edit);
+}
+
+CEngimaMachineSimulatorDoc::TextEdit CEngimaMachineSimulatorDoc::SetPlainText(const CString& text)
+{
+	return EditPlainText(GetPlainText().diff(text.GetString(), (size_t)text.GetLength()));
+}
+
+BOOL CEngimaMachineSimulatorDoc::SetKey(const EnigmaCore::EnigmaMachine& key)
+{
+	return m_editor.setKey(key) ? TRUE : FALSE;
+}
+
+void CEngimaMachineSimulatorDoc::EndSetKey(Session& session)
+{
+	m_editor.endSetKey(session);
+}
+
+CString CEngimaMachineSimulatorDoc::GetCipherText() const
+{
+	const TextModel::String& text = m_editor.ciphertext();
+	return CString(text.c_str(), (int)text.size());
+}
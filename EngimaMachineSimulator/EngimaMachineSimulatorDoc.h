@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "EnigmaEditor.h"
+#include "EnigmaState.h"
 
 class CEngimaMachineSimulatorDoc : public CDocument
 {
@@ -14,6 +16,32 @@ protected: // create from serialization only
 
 // Attributes
 public:
+	// The core encrypts the edit control's characters directly: letters A-Z/a-z are enciphered, everything else
+	// (including non-ASCII) passes through, so offsets in the plaintext and ciphertext are the same
+	typedef EnigmaCore::BasicCipherEditor<EnigmaCore::EnigmaMachine, TCHAR> Editor;
+	typedef Editor::Text TextModel;
+	typedef Editor::Patch TextEdit;
+	typedef Editor::Session Session;
+
+	// Machine settings (at the start of the message) and plaintext, persisted with the document
+	const EnigmaCore::MachineState& GetMachineState() const { return m_machineState; }
+	BOOL HasMachineState() const { return m_bHasMachineState; }
+	void SetMachineState(const EnigmaCore::MachineState& state);
+	const TextModel& GetPlainText() const { return m_editor.plaintext(); }
+
+	// Plaintext edits, as deltas or as a whole new text. Each returns how the ciphertext changed.
+	TextEdit EditPlainText(const TextEdit& edit);
+	TextEdit SetPlainText(const CString& text);
+
+	// The ciphertext: the plaintext encrypted under the key last set. SetKey encrypts a short text at once and
+	// returns FALSE for a long one (or after a long paste): the ciphertext is then out of date, with edits changing
+	// only the plaintext, until EndSetKey brings a session built on a worker thread from GetKey() and
+	// GetPlainText(). See EnigmaEditor.h.
+	BOOL SetKey(const EnigmaCore::EnigmaMachine& key);
+	void EndSetKey(Session& session);
+	BOOL IsCipherCurrent() const { return m_editor.isCipherCurrent(); }
+	const EnigmaCore::EnigmaMachine& GetKey() const { return m_editor.key(); }
+	CString GetCipherText() const;
 
 // Operations
 public:
@@ -36,6 +64,9 @@ public:
 #endif
 
 protected:
+	EnigmaCore::MachineState m_machineState;
+	BOOL m_bHasMachineState = FALSE;
+	Editor m_editor; // plaintext, key and ciphertext
 
 // Generated message map functions
 protected:
@@ -10,6 +10,7 @@
 #include "EngimaMachineSimulatorDoc.h"
 #include "EngimaMachineSimulatorView.h"
 #include "Enigma.h"
+#include "EnigmaMachineCache.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -34,6 +35,8 @@ BEGIN_MESSAGE_MAP(CEngimaMachineSimulatorView, CView)
 	ON_CONTROL_RANGE(CBN_SELCHANGE, CEngimaMachineSimulatorView::IDC_CB_REFLECTOR, CEngimaMachineSimulatorView::IDC_CB_R_RING, &CEngimaMachineSimulatorView::OnComboChanged)
 	ON_BN_CLICKED(CEngimaMachineSimulatorView::IDC_BTN_RESET, &CEngimaMachineSimulatorView::OnResetClicked)
 	ON_BN_CLICKED(CEngimaMachineSimulatorView::IDC_BTN_RANDOM, &CEngimaMachineSimulatorView::OnRandomizeClicked)
+	ON_WM_DESTROY()
+	ON_MESSAGE(CEngimaMachineSimulatorView::WM_APP_CIPHER_READY, &CEngimaMachineSimulatorView::OnCipherReady)
 END_MESSAGE_MAP()
 
 // CEngimaMachineSimulatorView construction/destruction
@@ -56,8 +59,19 @@ void CEngimaMachineSimulatorView::OnInitialUpdate()
 	CView::OnInitialUpdate();
 	CreateControls();
 	PopulateCombos();
+
+	// Take a copy first: filling the controls fires EN_CHANGE, which writes back into the document
+	CEngimaMachineSimulatorDoc* pDoc = GetDocument();
+	const BOOL bLoaded = pDoc->HasMachineState();
+	const MachineState loadedState = pDoc->GetMachineState();
+	const CString loadedPlain(pDoc->GetPlainText().str().c_str(), (int)pDoc->GetPlainText().size());
+
 	ResetSettings();
+	if (bLoaded)
+		ApplySettings(loadedState, loadedPlain);
 	LayoutControls();
+	// Populating the controls above is not a user edit
+	pDoc->SetModifiedFlag(FALSE);
 }
 
 // Layout helpers
@@ -97,6 +111,9 @@ void CEngimaMachineSimulatorView::CreateControls()
 
 	m_lblCipher.Create(_T("Ciphertext"), wsLbl, CRect(0,0,0,0), this);
 	m_edCipher.Create(wsEd | ES_READONLY, CRect(0,0,0,0), this, IDC_EDIT_CIPHER);
+	// No 30000 character default limit: documents may be megabytes
+	m_edPlain.SetLimitText(0);
+	m_edCipher.SetLimitText(0);
 }
 
 void CEngimaMachineSimulatorView::PopulateCombos()
@@ -112,6 +129,9 @@ void CEngimaMachineSimulatorView::PopulateCombos()
 		cb.AddString(_T("III"));
 		cb.AddString(_T("IV"));
 		cb.AddString(_T("V"));
+		cb.AddString(_T("VI"));
+		cb.AddString(_T("VII"));
+		cb.AddString(_T("VIII"));
 	};
 	addRotors(m_cbLeftRotor);
 	addRotors(m_cbMidRotor);
@@ -178,49 +198,129 @@ void CEngimaMachineSimulatorView::LayoutControls()
 // Update encryption when plaintext or configuration changes
 void CEngimaMachineSimulatorView::UpdateCiphertext()
 {
-	// Build machine from current UI selections
-	int reflIdx = m_cbReflector.GetCurSel();
-	Reflector refl = (reflIdx==1)? ReflectorC() : ReflectorB();
-
-	auto rotorFromIdx = [](int idx){
-		switch(idx){
-			case 0: return RotorI();
-			case 1: return RotorII();
-			case 2: return RotorIII();
-			case 3: return RotorIV();
-			default: return RotorV();
-		}
-	};
-
-	Rotor L = rotorFromIdx(m_cbLeftRotor.GetCurSel());
-	Rotor M = rotorFromIdx(m_cbMidRotor.GetCurSel());
-	Rotor R = rotorFromIdx(m_cbRightRotor.GetCurSel());
+	// The key from the current UI selections. The plugboard field is parsed when it changes (OnConfigChanged).
+	MachineState state;
+	state.reflector = (uint8_t)m_cbReflector.GetCurSel();
+	state.rotors[0] = (uint8_t)m_cbLeftRotor.GetCurSel();
+	state.rotors[1] = (uint8_t)m_cbMidRotor.GetCurSel();
+	state.rotors[2] = (uint8_t)m_cbRightRotor.GetCurSel();
+	state.rings[0] = (uint8_t)m_cbLeftRing.GetCurSel();
+	state.rings[1] = (uint8_t)m_cbMidRing.GetCurSel();
+	state.rings[2] = (uint8_t)m_cbRightRing.GetCurSel();
+	state.positions[0] = (uint8_t)m_cbLeftPos.GetCurSel();
+	state.positions[1] = (uint8_t)m_cbMidPos.GetCurSel();
+	state.positions[2] = (uint8_t)m_cbRightPos.GetCurSel();
+	for (int i = 0; i < 26; ++i)
+		state.plug[i] = (uint8_t)m_plugboard.map(i);
+
+	// A key seen before (stepping a position back and forth, trying rotor orders) comes ready-built
+	EnigmaMachine em;
+	if (!SharedMachineCache().get(state, em))
+		return;
+	CEngimaMachineSimulatorDoc* pDoc = GetDocument();
+	pDoc->SetMachineState(state);
 
-	L.setRing(m_cbLeftRing.GetCurSel());
-	M.setRing(m_cbMidRing.GetCurSel());
-	R.setRing(m_cbRightRing.GetCurSel());
+	// Encrypt the document's plaintext under the new key: at once if it is short, else on the worker
+	if (!pDoc->SetKey(em))
+	{
+		StartBackgroundEncryption();
+		return;
+	}
+	if (m_job != 0)
+	{
+		m_worker->cancel();
+		m_job = 0;
+		m_lblCipher.SetWindowText(_T("Ciphertext"));
+	}
+	m_edCipher.SetWindowText(pDoc->GetCipherText());
+}
 
-	L.setPosition(m_cbLeftPos.GetCurSel());
-	M.setPosition(m_cbMidPos.GetCurSel());
-	R.setPosition(m_cbRightPos.GetCurSel());
+// Plaintext edited, settings unchanged: the document takes the edit as a delta and re-encrypts from where it starts
+void CEngimaMachineSimulatorView::UpdatePlainText()
+{
+	CEngimaMachineSimulatorDoc* pDoc = GetDocument();
+	const CEngimaMachineSimulatorDoc::TextEdit edit = GetPlainTextEdit();
+	if (edit.empty())
+		return;
+	const CEngimaMachineSimulatorDoc::TextEdit cipher = pDoc->EditPlainText(edit);
+	if (!pDoc->IsCipherCurrent())
+	{
+		// A large paste goes to the worker like a new key, and a running job encrypts an older text: start
+		// again with this one
+		StartBackgroundEncryption();
+		return;
+	}
+	ShowCipherEdit(cipher);
+}
 
-	Plugboard plug; 
+// Encrypt the document's plaintext under its key on the worker thread. The cipher control is filled as chunks
+// arrive (OnCipherReady) and the document takes the finished session.
+void CEngimaMachineSimulatorView::StartBackgroundEncryption()
+{
+	if (!m_worker)
 	{
-		CString s; m_edPlugboard.GetWindowText(s);
-		CT2A a(s);
-		plug.configureFromPairs(std::string(a));
+		// Called on the worker thread
+		auto post = [this]
+		{
+			if (!m_async.posted)
+			{
+				m_async.posted = true;
+				::PostMessage(m_hWnd, WM_APP_CIPHER_READY, 0, 0);
+			}
+		};
+		m_worker.reset(new CipherWorker(
+			[this, post](const CipherWorker::Chunk& chunk)
+			{
+				std::lock_guard<std::mutex> lock(m_async.mutex);
+				m_async.chunks.push_back(chunk);
+				post();
+			},
+			[this, post](uint64_t job, CipherWorker::Session& session)
+			{
+				std::lock_guard<std::mutex> lock(m_async.mutex);
+				m_async.doneJob = job;
+				std::swap(m_async.done, session);
+				post();
+			}));
 	}
+	CEngimaMachineSimulatorDoc* pDoc = GetDocument();
+	m_job = m_worker->submit(pDoc->GetKey(), pDoc->GetPlainText().str());
+	m_edCipher.SetWindowText(_T(""));
+	m_lblCipher.SetWindowText(_T("Ciphertext (0%)"));
+}
 
-	EnigmaMachine em;
-	em.setReflector(refl);
-	em.setRotors(L,M,R);
-	em.setPlugboard(plug);
+// The change in the plaintext control since the document last saw it. Compares the control's own buffer with the
+// document piece by piece, so only the inserted characters are copied.
+CEngimaMachineSimulatorDoc::TextEdit CEngimaMachineSimulatorView::GetPlainTextEdit()
+{
+	const CEngimaMachineSimulatorDoc::TextModel& text = GetDocument()->GetPlainText();
+	HLOCAL h = m_edPlain.GetHandle();
+	const TCHAR* buffer = h ? static_cast<const TCHAR*>(LocalLock(h)) : nullptr;
+	if (buffer == nullptr)
+	{
+		CString plain; m_edPlain.GetWindowText(plain);
+		return text.diff(plain.GetString(), (size_t)plain.GetLength());
+	}
+	const CEngimaMachineSimulatorDoc::TextEdit edit = text.diff(buffer, (size_t)m_edPlain.GetWindowTextLength());
+	LocalUnlock(h);
+	return edit;
+}
 
-	// Encrypt
-	CString plain; m_edPlain.GetWindowText(plain);
-	CT2A ap(plain);
-	std::string cipher = em.encrypt(std::string(ap));
-	m_edCipher.SetWindowText(CA2T(cipher.c_str()));
+// Replace only the changed part of the ciphertext control
+void CEngimaMachineSimulatorView::ShowCipherEdit(const CEngimaMachineSimulatorDoc::TextEdit& edit)
+{
+	if (edit.empty())
+		return;
+	if (edit.offset + edit.removed > (size_t)m_edCipher.GetWindowTextLength())
+	{
+		m_edCipher.SetWindowText(GetDocument()->GetCipherText());
+		return;
+	}
+	m_edCipher.SetRedraw(FALSE);
+	m_edCipher.SetSel((int)edit.offset, (int)(edit.offset + edit.removed), TRUE);
+	m_edCipher.ReplaceSel(edit.inserted.c_str(), FALSE);
+	m_edCipher.SetRedraw(TRUE);
+	m_edCipher.Invalidate(FALSE);
 }
 
 void CEngimaMachineSimulatorView::ResetSettings()
@@ -246,8 +346,8 @@ void CEngimaMachineSimulatorView::RandomizeSettings()
 	std::uniform_int_distribution<int> dAZ(0,25);
 	std::uniform_int_distribution<int> dRef(0,1);
 
-	// pick3 distinct rotors from0..4
-	std::array<int,5> idx{{0,1,2,3,4}}; std::shuffle(idx.begin(), idx.end(), gen);
+	// pick3 distinct rotors from0..7
+	std::array<int,8> idx{{0,1,2,3,4,5,6,7}}; std::shuffle(idx.begin(), idx.end(), gen);
 	m_cbLeftRotor.SetCurSel(idx[0]);
 	m_cbMidRotor.SetCurSel(idx[1]);
 	m_cbRightRotor.SetCurSel(idx[2]);
@@ -266,14 +366,43 @@ void CEngimaMachineSimulatorView::RandomizeSettings()
 	std::string letters = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 	std::shuffle(letters.begin(), letters.end(), gen);
 	int pairs =6;
-	std::string pairsStr;
+	CString pairsStr;
 	for (int i=0;i<pairs*2 && i+1 < (int)letters.size(); i+=2)
 	{
-		pairsStr.push_back(letters[(size_t)i]);
-		pairsStr.push_back(letters[(size_t)i+1]);
-		pairsStr.push_back(' ');
+		pairsStr.AppendChar((TCHAR)letters[(size_t)i]);
+		pairsStr.AppendChar((TCHAR)letters[(size_t)i+1]);
+		pairsStr.AppendChar(_T(' '));
 	}
-	m_edPlugboard.SetWindowText(CA2T(pairsStr.c_str()));
+	m_edPlugboard.SetWindowText(pairsStr);
+}
+
+// Restore settings and plaintext (e.g. from a loaded document)
+void CEngimaMachineSimulatorView::ApplySettings(const MachineState& st, const CString& plain)
+{
+	m_cbReflector.SetCurSel(st.reflector);
+	m_cbLeftRotor.SetCurSel(st.rotors[0]);
+	m_cbMidRotor.SetCurSel(st.rotors[1]);
+	m_cbRightRotor.SetCurSel(st.rotors[2]);
+	m_cbLeftRing.SetCurSel(st.rings[0]);
+	m_cbMidRing.SetCurSel(st.rings[1]);
+	m_cbRightRing.SetCurSel(st.rings[2]);
+	m_cbLeftPos.SetCurSel(st.positions[0]);
+	m_cbMidPos.SetCurSel(st.positions[1]);
+	m_cbRightPos.SetCurSel(st.positions[2]);
+
+	CString pairsStr;
+	for (int i=0;i<26;++i)
+	{
+		if (st.plug[i] > i)
+		{
+			pairsStr.AppendChar((TCHAR)i2ch(i));
+			pairsStr.AppendChar((TCHAR)i2ch(st.plug[i]));
+			pairsStr.AppendChar(_T(' '));
+		}
+	}
+	m_edPlugboard.SetWindowText(pairsStr);
+	m_edPlain.SetWindowText(plain);
+	UpdateCiphertext();
 }
 
 // Message handlers
@@ -286,11 +415,66 @@ void CEngimaMachineSimulatorView::OnSize(UINT nType, int cx, int cy)
 
 void CEngimaMachineSimulatorView::OnEditPlainChanged()
 {
-	UpdateCiphertext();
+	UpdatePlainText();
+}
+
+void CEngimaMachineSimulatorView::OnDestroy()
+{
+	// Joins the worker: no callbacks touch m_async after this
+	m_worker.reset();
+	CView::OnDestroy();
+}
+
+LRESULT CEngimaMachineSimulatorView::OnCipherReady(WPARAM /*wParam*/, LPARAM /*lParam*/)
+{
+	std::vector<CipherWorker::Chunk> chunks;
+	uint64_t doneJob = 0;
+	CipherWorker::Session done;
+	{
+		std::lock_guard<std::mutex> lock(m_async.mutex);
+		chunks.swap(m_async.chunks);
+		std::swap(doneJob, m_async.doneJob);
+		std::swap(done, m_async.done);
+		m_async.posted = false;
+	}
+	if (m_job == 0)
+		return 0;
+
+	// Chunks of the current job come in order: append them, and show how far it got
+	size_t progress = 0, total = 0;
+	for (const CipherWorker::Chunk& chunk : chunks)
+	{
+		if (chunk.job != m_job)
+			continue;
+		const int end = m_edCipher.GetWindowTextLength();
+		m_edCipher.SetSel(end, end, TRUE);
+		m_edCipher.ReplaceSel(chunk.text.c_str(), FALSE);
+		progress = chunk.offset + chunk.text.size();
+		total = chunk.total;
+	}
+	if (total != 0)
+	{
+		CString label;
+		label.Format(_T("Ciphertext (%d%%)"), (int)(progress * 100 / total));
+		m_lblCipher.SetWindowText(label);
+	}
+
+	if (doneJob == m_job)
+	{
+		CEngimaMachineSimulatorDoc* pDoc = GetDocument();
+		pDoc->EndSetKey(done);
+		m_job = 0;
+		m_lblCipher.SetWindowText(_T("Ciphertext"));
+		if ((size_t)m_edCipher.GetWindowTextLength() != pDoc->GetPlainText().size())
+			m_edCipher.SetWindowText(pDoc->GetCipherText());
+	}
+	return 0;
 }
 
 void CEngimaMachineSimulatorView::OnConfigChanged()
 {
+	CString s; m_edPlugboard.GetWindowText(s);
+	m_plugboard.configureFromPairs(s.GetString());
 	UpdateCiphertext();
 }
 
@@ -4,6 +4,11 @@
 #pragma once
 
 #include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "EnigmaWorker.h"
 
 class CEngimaMachineSimulatorView : public CView
 {
@@ -49,6 +54,8 @@ protected:
 	afx_msg void OnComboChanged(UINT nID);
 	afx_msg void OnResetClicked();
 	afx_msg void OnRandomizeClicked();
+	afx_msg void OnDestroy();
+	afx_msg LRESULT OnCipherReady(WPARAM wParam, LPARAM lParam);
 	DECLARE_MESSAGE_MAP()
 
 public:
@@ -71,6 +78,9 @@ public:
 		IDC_BTN_RANDOM
 	};
 
+	// Posted by the encryption worker when chunks or a finished session are waiting in m_async
+	enum : UINT { WM_APP_CIPHER_READY = WM_APP + 1 };
+
 private:
 	// UI controls
 	CStatic m_lblReflector, m_lblRotors, m_lblPos, m_lblRing, m_lblPlug, m_lblPlain, m_lblCipher;
@@ -79,13 +89,34 @@ private:
 	CComboBox m_cbLeftRing, m_cbMidRing, m_cbRightRing;
 	CEdit m_edPlugboard, m_edPlain, m_edCipher;
 	CButton m_btnReset, m_btnRandom;
+	EnigmaCore::Plugboard m_plugboard; // parsed from m_edPlugboard on each change
+
+	// Background encryption. The worker's callbacks leave their results in m_async and post WM_APP_CIPHER_READY;
+	// the cipher control shows only job m_job (0: none running, the document's ciphertext is current).
+	typedef EnigmaCore::BasicEncryptionWorker<EnigmaCore::EnigmaMachine, TCHAR> CipherWorker;
+	std::unique_ptr<CipherWorker> m_worker;
+	uint64_t m_job{ 0 };
+	struct AsyncResults
+	{
+		std::mutex mutex;
+		std::vector<CipherWorker::Chunk> chunks;
+		uint64_t doneJob{ 0 };
+		CEngimaMachineSimulatorDoc::Session done;
+		bool posted{ false };
+	} m_async;
+
 
 	void CreateControls();
 	void LayoutControls();
 	void PopulateCombos();
 	void UpdateCiphertext();
+	void UpdatePlainText();
+	void StartBackgroundEncryption();
+	CEngimaMachineSimulatorDoc::TextEdit GetPlainTextEdit();
+	void ShowCipherEdit(const CEngimaMachineSimulatorDoc::TextEdit& edit);
 	void ResetSettings();
 	void RandomizeSettings();
+	void ApplySettings(const EnigmaCore::MachineState& state, const CString& plain);
 };
 
 #ifndef _DEBUG  // debug version in EngimaMachineSimulatorView.cpp
@@ -1,16 +1,24 @@
 // Enigma.h - Header-only Enigma machine core for MFC sample app (C++14)
 //
-// This module implements a simple, didactic Enigma M3 simulation with:
+// This module implements a simple, didactic Enigma M3/M4 simulation with:
 // - Plugboard
-// -3 Rotors (choose from I..V)
-// - Reflector (B or C)
-// - Stepping with historical "double-stepping" behavior
+// -3 stepping rotors (choose from I..VIII; VI..VIII carry two notches)
+// - M4: a stationary Greek wheel (Beta or Gamma) in front of a thin reflector
+// - Reflector (B or C, thick or thin)
+// - Stepping with historical "double-stepping" behavior, or cog stepping with a moving reflector (Enigma G)
 //
 // Design notes:
 // - Characters are0..25 for A..Z. Non-alphabet characters are passed through unchanged by helpers in the UI.
 // - Ring settings and rotor positions are supported.
 // - Turnover notch is affected by ring setting (approximation used in historical simulations).
+// - Notches are kept as a bit mask over (position - ring), so two-notch rotors cost the same check as one.
+// - BasicEnigmaMachineN<N> holds N rotors; only the right three step. The N-3 leftmost rotors never move, so
+//   they are folded with the reflector into one turnaround table and an M4 letter costs the same as an M3 one.
 // - This file is header-only to avoid touching the project file list. Include it where needed.
+// - Wirings are compiled once into shared byte tables (CompiledWiring); user-defined components are loaded and
+//   validated by ComponentRegistry (EnigmaComponents.h).
+// - The built-in tables are compiled by the compiler (constexpr) and live in read-only data. Machines built from
+//   the built-in components work in constant expressions: EncryptLiteral, golden vectors in EnigmaVectors.h.
 //
 // References for wirings (public domain sources):
 // Rotor I : EKMFLGDQVZNTOWYHXUSPAIBRCJ, notch Q
@@ -18,248 +26,1028 @@
 // Rotor III: BDFHJLCPRTXVZNYEIWGAKMUSQO, notch V
 // Rotor IV : ESOVPZJAYQUIRHXLNFTGKDCMWB, notch J
 // Rotor V : VZBRGITYUPSDNHLXAWMJQOFECK, notch Z
+// Rotor VI : JPGVOUMFYQBENHZRDKASXLICTW, notches Z+M
+// Rotor VII: NZJHGRCXMYSWBOUFAIVLPEKQDT, notches Z+M
+// Rotor VIII: FKQHTLXOCBJSPDZRAMEWNIUYGV, notches Z+M
+// Greek Beta : LEYJVCNIXWPBQMDRTAKZGFUHOS (M4 only, never steps)
+// Greek Gamma: FSOKANUERHMBTIYCWLQPZXVGJD (M4 only, never steps)
 // Reflector B: YRUHQSLDPXNGOKMIEBFZCWVJAT
 // Reflector C: FVPJIAOYEDRZXWGCTKUQSBNMHL
+// Reflector B thin: ENKQAUYWJICOPBLMDXZVFTHRGS (M4)
+// Reflector C thin: RDOBJNTKVEHMLFCWZAXGYIPSUQ (M4)
+// Abwehr G (G-312), cog stepping, settable reflector that moves with the rotors:
+// Rotor G-I : DMTWSILRUYQNKFEJCAZBPGXOHV, notches SUVWZABCEFGIKLOPQ
+// Rotor G-II : HQZGPJTMOBLNCIFDYAWVEUSRKX, notches STVYZACDFGHKMNQ
+// Rotor G-III: UQNTLSZFMREHDPXKIBVYGJCWOA, notches UWXAEFHKMNR
+// Reflector G: RULQMZJSYGOCETKWDAHNBXPVIF
+// Entry wheel G: QWERTZUIOASDFGHJKPYXCVBNML (keyboard order; the M3/M4 entry wheel is A..Z)
 //
 // Extension ideas (see bottom): saving presets, visualization, keyboard lampboard, etc.
 
 #pragma once
 
 #include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
 #include <vector>
 #include <string>
 #include <algorithm>
 #include <random>
+#include <utility>
 
 namespace EnigmaCore
 {
- inline int mod26(int v) { v %=26; return v <0 ? v +26 : v; }
- inline int ch2i(char c) { return (c >= 'A' && c <= 'Z') ? (c - 'A') : (c >= 'a' && c <= 'z') ? (c - 'a') : -1; }
- inline char i2ch(int i) { return static_cast<char>('A' + mod26(i)); }
+ // The core is constexpr wherever it does not need the heap or the wiring pool: the built-in components, the
+ // plugboard and machines assembled from them can be set up, stepped and used in constant expressions (see
+ // EncryptLiteral and EnigmaVectors.h). Hence plain arrays instead of std::array, whose non-const operator[] is
+ // not constexpr before C++17.
+ constexpr int mod26(int v) { v %=26; return v <0 ? v +26 : v; }
+ // Any character type: char (ASCII, or UTF-8 bytes), wchar_t, char16_t, char32_t. Only ASCII letters map.
+ template <class CharT>
+ constexpr int ch2i(CharT c) { return (c >= CharT('A') && c <= CharT('Z')) ? int(c - CharT('A')) : (c >= CharT('a') && c <= CharT('z')) ? int(c - CharT('a')) : -1; }
+ constexpr char i2ch(int i) { return static_cast<char>('A' + mod26(i)); }
 
  struct Wiring
  {
- std::array<int,26> fwd{}; // forward mapping: input index -> output index
- std::array<int,26> rev{}; // reverse mapping: inverse of fwd
+ int fwd[26]{}; // forward mapping: input index -> output index
+ int rev[26]{}; // reverse mapping: inverse of fwd
 
- static Wiring fromString(const std::string& s)
+ // Parse26 letters (either case) that form a permutation. Returns false and leaves out unchanged otherwise.
+ static constexpr bool tryParse(const char* s, Wiring& out)
  {
  Wiring w{};
+ for (int i =0; i <26; ++i) w.rev[i] = -1;
  for (int i =0; i <26; ++i)
  {
- int o = ch2i(s[(size_t)i]);
- w.fwd[(size_t)i] = o;
+ int o = ch2i(s[i]); // also stops at the terminator of a short string
+ if (o <0 || w.rev[o] >=0) return false;
+ w.fwd[i] = o;
+ w.rev[o] = i;
  }
- for (int i =0; i <26; ++i)
+ if (s[26] !='\0') return false;
+ out = w;
+ return true;
+ }
+ static bool tryParse(const std::string& s, Wiring& out) { return s.size() ==26 && tryParse(s.c_str(), out); }
+
+ // Used with the literals below. A string that is not a permutation gives the identity.
+ static constexpr Wiring fromString(const char* s)
  {
- w.rev[(size_t)w.fwd[(size_t)i]] = i;
+ Wiring w = identity();
+ tryParse(s, w);
+ return w;
  }
+ static Wiring fromString(const std::string& s) { return fromString(s.c_str()); }
+
+ static constexpr Wiring identity()
+ {
+ Wiring w{};
+ for (int i =0; i <26; ++i) w.fwd[i] = w.rev[i] = i;
  return w;
  }
+
+ // Reflectors must pair every letter with a different one.
+ constexpr bool isInvolution() const
+ {
+ for (int i =0; i <26; ++i)
+ {
+ if (fwd[i] == i || fwd[fwd[i]] != i) return false;
+ }
+ return true;
+ }
  };
 
- // Plugboard: simple pair-swaps
- class Plugboard
+ // A wiring compiled for the hot paths: byte tables, plus the map at every offset o = position - ring
+ // (rotFwd[o*26 + i] = fwd[(i + o) mod26] - o, mod26) so rotors and engines index instead of doing modular
+ // arithmetic. Compiled wirings are interned by CompileWiring: every rotor, reflector and entry wheel with the
+ // same wiring points at one cache-line aligned copy, and copying a component copies a pointer.
+ struct alignas(64) CompiledWiring
  {
- public:
- Plugboard()
+ uint8_t fwd[26];
+ uint8_t rev[26];
+ uint8_t rotFwd[26 *26];
+ uint8_t rotRev[26 *26];
+
+ constexpr void compile(const Wiring& w)
  {
- reset();
+ for (int i =0; i <26; ++i)
+ {
+ fwd[i] = (uint8_t)w.fwd[i];
+ rev[i] = (uint8_t)w.rev[i];
+ }
+ for (int o =0; o <26; ++o)
+ {
+ for (int i =0; i <26; ++i)
+ {
+ int in = i + o;
+ if (in >=26) in -=26;
+ int f = fwd[in] - o, b = rev[in] - o;
+ rotFwd[o *26 + i] = (uint8_t)(f <0 ? f +26 : f);
+ rotRev[o *26 + i] = (uint8_t)(b <0 ? b +26 : b);
+ }
+ }
  }
 
- void reset()
+ static constexpr CompiledWiring from(const Wiring& w)
  {
- for (int i =0; i <26; ++i) m_map[(size_t)i] = i;
+ CompiledWiring c{};
+ c.compile(w);
+ return c;
  }
+ };
 
- // Configure from pairs like "AB CD EF" (whitespace ignored). Invalid pairs are ignored.
- void configureFromPairs(const std::string& pairs)
+ // Built-in component definitions, in UI/keysheet/snapshot id order. ComponentRegistry (EnigmaComponents.h) starts
+ // from these, so registry ids and factory ids agree.
+ struct BuiltinComponent
  {
- reset();
- char a =0, b =0;
- for (char c : pairs)
+ const char* name;
+ const char* wiring;
+ const char* notches; // rotors only
+ };
+
+ const int kBuiltinRotorCount =13;
+ const int kBuiltinReflectorCount =5;
+ const int kBuiltinEntryWheelCount =2;
+
+ // The definitions and their compiled wirings are constant data, compiled by the compiler into read-only memory
+ // rather than at startup. They are static members of class templates because C++14 has no inline variables:
+ // this way the header defines each table once for the whole program.
+ template <class Unused = void>
+ struct BuiltinData
+ {
+ static constexpr BuiltinComponent rotors[kBuiltinRotorCount] = {
+ { "I", "EKMFLGDQVZNTOWYHXUSPAIBRCJ", "Q" },
+ { "II", "AJDKSIRUXBLHWTMCQGZNPYFVOE", "E" },
+ { "III", "BDFHJLCPRTXVZNYEIWGAKMUSQO", "V" },
+ { "IV", "ESOVPZJAYQUIRHXLNFTGKDCMWB", "J" },
+ { "V", "VZBRGITYUPSDNHLXAWMJQOFECK", "Z" },
+ { "VI", "JPGVOUMFYQBENHZRDKASXLICTW", "ZM" },
+ { "VII", "NZJHGRCXMYSWBOUFAIVLPEKQDT", "ZM" },
+ { "VIII", "FKQHTLXOCBJSPDZRAMEWNIUYGV", "ZM" },
+ { "BETA", "LEYJVCNIXWPBQMDRTAKZGFUHOS", "" },
+ { "GAMMA", "FSOKANUERHMBTIYCWLQPZXVGJD", "" },
+ { "G-I", "DMTWSILRUYQNKFEJCAZBPGXOHV", "SUVWZABCEFGIKLOPQ" },
+ { "G-II", "HQZGPJTMOBLNCIFDYAWVEUSRKX", "STVYZACDFGHKMNQ" },
+ { "G-III", "UQNTLSZFMREHDPXKIBVYGJCWOA", "UWXAEFHKMNR" },
+ };
+ static constexpr BuiltinComponent reflectors[kBuiltinReflectorCount] = {
+ { "B", "YRUHQSLDPXNGOKMIEBFZCWVJAT", "" },
+ { "C", "FVPJIAOYEDRZXWGCTKUQSBNMHL", "" },
+ { "B-THIN", "ENKQAUYWJICOPBLMDXZVFTHRGS", "" },
+ { "C-THIN", "RDOBJNTKVEHMLFCWZAXGYIPSUQ", "" },
+ { "G", "RULQMZJSYGOCETKWDAHNBXPVIF", "" },
+ };
+ static constexpr BuiltinComponent entryWheels[kBuiltinEntryWheelCount] = {
+ { "ABC", "ABCDEFGHIJKLMNOPQRSTUVWXYZ", "" },
+ { "QWERTZU", "QWERTZUIOASDFGHJKPYXCVBNML", "" },
+ };
+ // All-zero wiring of default-constructed components (kept from the former value-initialised Wiring)
+ static constexpr CompiledWiring empty{};
+ };
+ template <class U> constexpr BuiltinComponent BuiltinData<U>::rotors[kBuiltinRotorCount];
+ template <class U> constexpr BuiltinComponent BuiltinData<U>::reflectors[kBuiltinReflectorCount];
+ template <class U> constexpr BuiltinComponent BuiltinData<U>::entryWheels[kBuiltinEntryWheelCount];
+ template <class U> constexpr CompiledWiring BuiltinData<U>::empty;
+
+ constexpr const BuiltinComponent* BuiltinRotors() { return BuiltinData<>::rotors; }
+ constexpr const BuiltinComponent* BuiltinReflectors() { return BuiltinData<>::reflectors; }
+ constexpr const BuiltinComponent* BuiltinEntryWheels() { return BuiltinData<>::entryWheels; }
+
+ enum BuiltinKind { kBuiltinRotor, kBuiltinReflector, kBuiltinEntryWheel };
+
+ constexpr const BuiltinComponent* BuiltinDefinitions(int kind)
  {
- if (c == ' ' || c == '\t' || c == '\n' || c == '\r') continue;
- if (std::isalpha(static_cast<unsigned char>(c)))
+ return kind == kBuiltinRotor ? BuiltinRotors() : kind == kBuiltinReflector ? BuiltinReflectors() : BuiltinEntryWheels();
+ }
+
+ // One constant per wiring, so each table is a separate (and short) constant evaluation.
+ template <int Kind, int I>
+ struct BuiltinTable
  {
- if (!a) a = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
- else if (!b) b = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
- if (a && b)
+ static constexpr CompiledWiring value = CompiledWiring::from(Wiring::fromString(BuiltinDefinitions(Kind)[I].wiring));
+ };
+ template <int Kind, int I> constexpr CompiledWiring BuiltinTable<Kind, I>::value;
+
+ template <int Kind, class Indices> struct BuiltinTableList;
+ template <int Kind, size_t... I>
+ struct BuiltinTableList<Kind, std::index_sequence<I...>>
  {
- int ia = ch2i(a), ib = ch2i(b);
- if (ia != -1 && ib != -1 && ia != ib)
+ static constexpr const CompiledWiring* tables[sizeof...(I)] = { &BuiltinTable<Kind, (int)I>::value... };
+ };
+ template <int Kind, size_t... I> constexpr const CompiledWiring* BuiltinTableList<Kind, std::index_sequence<I...>>::tables[sizeof...(I)];
+
+ // The factories below only copy pointers to these.
+ constexpr const CompiledWiring& BuiltinRotorWiring(int idx)
  {
- // swap, but ensure neither already swapped
- if (m_map[(size_t)ia] == ia && m_map[(size_t)ib] == ib)
+ return *BuiltinTableList<kBuiltinRotor, std::make_index_sequence<kBuiltinRotorCount>>::tables[idx];
+ }
+ constexpr const CompiledWiring& BuiltinReflectorWiring(int idx)
+ {
+ return *BuiltinTableList<kBuiltinReflector, std::make_index_sequence<kBuiltinReflectorCount>>::tables[idx];
+ }
+ constexpr const CompiledWiring& BuiltinEntryWheelWiring(int idx)
  {
- std::swap(m_map[(size_t)ia], m_map[(size_t)ib]);
+ return *BuiltinTableList<kBuiltinEntryWheel, std::make_index_sequence<kBuiltinEntryWheelCount>>::tables[idx];
  }
+
+ // The shared compiled copy of a wiring, built on first use. Entries are never freed, so the reference stays
+ // valid for the life of the process (components may live in static objects). The pool starts out with the
+ // built-in tables, so a wiring equal to a built-in one gets the constant table. Thread-safe.
+ inline const CompiledWiring& CompileWiring(const Wiring& w)
+ {
+ typedef std::array<int,26> Key;
+ static std::mutex lock;
+ static std::map<Key, const CompiledWiring*> pool = []
+ {
+ std::map<Key, const CompiledWiring*> p;
+ auto seed = [&p](const CompiledWiring& c)
+ {
+ Key k{};
+ for (int i =0; i <26; ++i) k[(size_t)i] = c.fwd[i];
+ p.emplace(k, &c);
+ };
+ seed(BuiltinData<>::empty);
+ for (int i =0; i < kBuiltinRotorCount; ++i) seed(BuiltinRotorWiring(i));
+ for (int i =0; i < kBuiltinReflectorCount; ++i) seed(BuiltinReflectorWiring(i));
+ for (int i =0; i < kBuiltinEntryWheelCount; ++i) seed(BuiltinEntryWheelWiring(i));
+ return p;
+ }();
+ Key key{};
+ std::copy(w.fwd, w.fwd +26, key.begin());
+ std::lock_guard<std::mutex> guard(lock);
+ const CompiledWiring*& entry = pool[key];
+ if (!entry)
+ {
+ // operator new only guarantees alignof(max_align_t) before C++17, so align by hand
+ void* raw = ::operator new(sizeof(CompiledWiring) + alignof(CompiledWiring));
+ uintptr_t at = ((uintptr_t)raw + alignof(CompiledWiring) -1) & ~(uintptr_t)(alignof(CompiledWiring) -1);
+ CompiledWiring* c = new ((void*)at) CompiledWiring;
+ c->compile(w);
+ entry = c;
+ }
+ return *entry;
+ }
+
+ constexpr const CompiledWiring& IdentityWiring() { return BuiltinEntryWheelWiring(0); }
+ constexpr const CompiledWiring& EmptyWiring() { return BuiltinData<>::empty; }
+
+ // Notch letters to a notch mask, e.g. "ZM" -> bits25 and12. Non-letters are ignored.
+ constexpr uint32_t NotchBits(const char* letters)
+ {
+ uint32_t mask =0;
+ for (const char* p = letters; *p; ++p)
+ {
+ if (ch2i(*p) >=0) mask |=1u << ch2i(*p);
+ }
+ return mask;
+ }
+
+ // Plugboard: simple pair-swaps
+ class Plugboard
+ {
+ public:
+ constexpr Plugboard()
+ {
+ reset();
  }
- a = b =0;
+
+ constexpr void reset()
+ {
+ for (int i =0; i <26; ++i) m_map[i] = i;
  }
+
+ // Configure from pairs like "AB CD EF" in any character type (either case; whitespace and other non-letters
+ // ignored). Invalid pairs are ignored.
+ template <class CharT>
+ constexpr void configureFromPairs(const CharT* pairs)
+ {
+ reset();
+ int a = -1;
+ for (const CharT* p = pairs; *p; ++p)
+ {
+ const int c = ch2i(*p);
+ if (c <0) continue;
+ if (a <0) { a = c; continue; }
+ connect(a, c);
+ a = -1;
  }
  }
+ template <class CharT>
+ void configureFromPairs(const std::basic_string<CharT>& pairs) { configureFromPairs(pairs.c_str()); }
+
+ // Connect two letters (0..25). Returns false (and changes nothing) if either is invalid or already plugged.
+ constexpr bool connect(int ia, int ib)
+ {
+ if (ia <0 || ia >=26 || ib <0 || ib >=26 || ia == ib) return false;
+ // swap, but ensure neither already swapped
+ if (m_map[ia] != ia || m_map[ib] != ib) return false;
+ m_map[ia] = ib;
+ m_map[ib] = ia;
+ return true;
  }
 
- int map(int i) const { return m_map[(size_t)mod26(i)]; }
+ constexpr int map(int i) const { return m_map[mod26(i)]; }
 
  private:
- std::array<int,26> m_map{};
+ int m_map[26]{};
  };
 
  class Rotor
  {
  public:
  Rotor() = default;
- Rotor(const Wiring& w, int notchIndex)
- : m_wiring(w), m_notch(notchIndex)
+ Rotor(const Wiring& w, int notchIndex, int id = -1)
+ : m_wiring(&CompileWiring(w)), m_notchMask(notchIndex >=0 ? 1u << mod26(notchIndex) :0u), m_id(id)
+ {
+ updateRows();
+ }
+ // Any number of notches given as letters, e.g. "ZM" for rotors VI..VIII or "" for a Greek wheel.
+ Rotor(const Wiring& w, const char* notches, int id = -1)
+ : m_wiring(&CompileWiring(w)), m_notchMask(NotchBits(notches)), m_id(id)
+ {
+ updateRows();
+ }
+ // From an already compiled (shared) wiring, as the factories and ComponentRegistry do
+ constexpr Rotor(const CompiledWiring& w, uint32_t notchMask, int id = -1)
+ : m_wiring(&w), m_notchMask(notchMask), m_id(id)
  {
+ updateRows();
  }
 
- void setPosition(int p) { m_pos = mod26(p); }
- void setRing(int r) { m_ring = mod26(r); }
+ constexpr void setPosition(int p) { m_pos = mod26(p); updateOffset(); }
+ constexpr void setRing(int r) { m_ring = mod26(r); updateOffset(); }
 
- int position() const { return m_pos; }
- int ring() const { return m_ring; }
+ constexpr int position() const { return m_pos; }
+ constexpr int ring() const { return m_ring; }
+ constexpr int offset() const { return m_offset; } // (pos - ring) mod26, the row of the rotated tables in use
+ constexpr int id() const { return m_id; } // index for RotorByIndex, -1 for custom wirings
+ constexpr uint32_t notchMask() const { return m_notchMask; } // bit n set: turnover at (pos - ring) == n
+ constexpr const CompiledWiring& wiring() const { return *m_wiring; }
 
  // Returns true if rotor was at notch (causing turnover) considering ring setting.
- bool atNotch() const
+ constexpr bool atNotch() const
  {
- // Approximate: turnover when (pos - ring) == notch
- return mod26(m_pos - m_ring) == m_notch;
+ // Approximate: turnover when bit (pos - ring) of the notch mask is set
+ return (m_notchMask >> m_offset) &1u;
  }
 
- // Advance rotor by one step
- void step() { m_pos = mod26(m_pos +1); }
-
- // Forward pass (right -> left)
- int forward(int i) const
+ // Advance rotor by one step. Position and offset wrap by compare, and the rows move with the offset.
+ constexpr void step()
  {
- int shifted = mod26(i + m_pos - m_ring);
- int wired = m_wiring.fwd[(size_t)shifted];
- return mod26(wired - m_pos + m_ring);
+ m_pos = m_pos ==25 ?0 : m_pos +1;
+ m_offset = m_offset ==25 ?0 : m_offset +1;
+ updateRows();
  }
 
- // Backward pass (left -> right)
- int backward(int i) const
+ // Move back by one step (inverse of step)
+ constexpr void unstep()
  {
- int shifted = mod26(i + m_pos - m_ring);
- int wired = m_wiring.rev[(size_t)shifted];
- return mod26(wired - m_pos + m_ring);
+ m_pos = m_pos ==0 ?25 : m_pos -1;
+ m_offset = m_offset ==0 ?25 : m_offset -1;
+ updateRows();
  }
 
+ // Forward pass (right -> left). i must be0..25: the row for the current offset already holds
+ // fwd[(i + offset) mod26] - offset, so the pass is a single load.
+ constexpr int forward(int i) const { return m_fwdRow[i]; }
+
+ // Backward pass (left -> right), i0..25
+ constexpr int backward(int i) const { return m_revRow[i]; }
+
  private:
- Wiring m_wiring{};
- int m_notch{0 }; //0..25
+ constexpr void updateOffset()
+ {
+ m_offset = mod26(m_pos - m_ring);
+ updateRows();
+ }
+ constexpr void updateRows()
+ {
+ m_fwdRow = m_wiring->rotFwd +26 * m_offset;
+ m_revRow = m_wiring->rotRev +26 * m_offset;
+ }
+
+ const CompiledWiring* m_wiring{ &EmptyWiring() };
+ const uint8_t* m_fwdRow{ EmptyWiring().rotFwd }; // rows of the compiled tables at m_offset
+ const uint8_t* m_revRow{ EmptyWiring().rotRev };
+ uint32_t m_notchMask{1u }; // bits0..25 (default: notch at A)
  int m_pos{0 }; //0..25 (window letter A=0)
  int m_ring{0 }; //0..25 (ring setting A=0 -> historic ring=1)
+ int m_offset{0 }; // (m_pos - m_ring) mod26
+ int m_id{-1 };
  };
 
  class Reflector
  {
  public:
  Reflector() = default;
- explicit Reflector(const Wiring& w) : m_wiring(w) {}
- int map(int i) const { return m_wiring.fwd[(size_t)mod26(i)]; }
+ explicit Reflector(const Wiring& w, int id = -1) : m_wiring(&CompileWiring(w)), m_row(m_wiring->rotFwd), m_id(id) {}
+ explicit constexpr Reflector(const CompiledWiring& w, int id = -1) : m_wiring(&w), m_row(w.rotFwd), m_id(id) {}
+ constexpr int map(int i) const { return m_row[i]; } // i0..25
+ constexpr int id() const { return m_id; } // index for ReflectorByIndex, -1 for custom wirings
+ constexpr const CompiledWiring& wiring() const { return *m_wiring; }
+
+ // Settable/rotating reflectors (Enigma G). Fixed reflectors stay at position A, ring A.
+ constexpr void setPosition(int p) { m_pos = mod26(p); updateRow(); }
+ constexpr void setRing(int r) { m_ring = mod26(r); updateRow(); }
+ constexpr int position() const { return m_pos; }
+ constexpr int ring() const { return m_ring; }
+ constexpr int offset() const { return m_offset; }
+ constexpr void step()
+ {
+ m_pos = m_pos ==25 ?0 : m_pos +1;
+ m_offset = m_offset ==25 ?0 : m_offset +1;
+ m_row = m_wiring->rotFwd +26 * m_offset;
+ }
+ constexpr void unstep()
+ {
+ m_pos = m_pos ==0 ?25 : m_pos -1;
+ m_offset = m_offset ==0 ?25 : m_offset -1;
+ m_row = m_wiring->rotFwd +26 * m_offset;
+ }
  private:
- Wiring m_wiring{};
+ constexpr void updateRow()
+ {
+ m_offset = mod26(m_pos - m_ring);
+ m_row = m_wiring->rotFwd +26 * m_offset;
+ }
+
+ const CompiledWiring* m_wiring{ &EmptyWiring() };
+ const uint8_t* m_row{ EmptyWiring().rotFwd };
+ int m_pos{0 };
+ int m_ring{0 };
+ int m_offset{0 };
+ int m_id{-1 };
  };
 
- class EnigmaMachine
+ // Entry wheel (Eintrittswalze) between plugboard and rotors. The wiring lists the keys in contact order: key
+ // s[i] is wired to contact i. The M3/M4 use A..Z (identity, id0), the G uses QWERTZU (id1).
+ class EntryWheel
  {
  public:
- EnigmaMachine() = default;
+ EntryWheel() = default;
+ explicit EntryWheel(const Wiring& w, int id = -1) : m_wiring(&CompileWiring(w)), m_id(id) {}
+ explicit constexpr EntryWheel(const CompiledWiring& w, int id = -1) : m_wiring(&w), m_id(id) {}
+ constexpr int in(int key) const { return m_wiring->rev[mod26(key)]; } // key -> rotor contact
+ constexpr int out(int contact) const { return m_wiring->fwd[mod26(contact)]; } // rotor contact -> lamp
+ constexpr int id() const { return m_id; }
+ constexpr const CompiledWiring& wiring() const { return *m_wiring; }
+ private:
+ const CompiledWiring* m_wiring{ &IdentityWiring() };
+ int m_id{0 };
+ };
+
+ // Hot-path stages reported to instrumentation probes (see EnigmaProbe.h)
+ enum EnigmaStage { kStageStep, kStagePlugIn, kStageRotorsForward, kStageReflector, kStageRotorsBackward, kStagePlugOut, kStageCount };
+
+ // Default probe: every hook is an empty inline function and the probe is an empty base, so
+ // BasicEnigmaMachine<NullProbe> compiles to the same code as an uninstrumented machine.
+ struct NullProbe
+ {
+ constexpr void letterBegin() {}
+ constexpr void stageDone(EnigmaStage) {}
+ constexpr void stepped(bool /*rightTurnover*/, bool /*middleTurnover*/) {}
+ };
+
+ // Stepping policies. A policy is a template argument of BasicEnigmaMachineN, so the per-letter step is inlined
+ // and there is no virtual dispatch. Each one provides:
+ // - stationaryRotors(n): how many leftmost rotors never move (they are folded into the turnaround table);
+ // - kMovesReflector: whether the reflector takes part in the stepping;
+ // - step(rotors, reflector, rightCarry, middleCarry): one key press; returns which parts moved (bit i: rotor i,
+//   bit N: the reflector), which is all BasicEnigmaMachineN::unstep needs to take the key press back;
+ // - SeekTable<N>: precomputed stepping periods for the key's notches, so a machine can be moved k letters
+ //   ahead in O(1) (BasicEnigmaMachineN::advance) instead of stepping k times. kSeekBuildCost is the number of
+ //   plain steps that building one costs; shorter moves just step.
+ // Seek tables work on offsets (position - ring) of the N rotors plus the reflector at index N.
+
+ // M3/M4 ratchet: pawls on the right three rotors, with the historical double step of the middle rotor.
+ struct RatchetStepping
+ {
+ static constexpr int stationaryRotors(int n) { return n -3; }
+ static const bool kMovesReflector = false;
+ static const uint64_t kSeekBuildCost =26 *26 *26;
 
- void setRotors(const Rotor& left, const Rotor& middle, const Rotor& right)
+ template <size_t N>
+ static constexpr uint32_t step(Rotor (&r)[N], Reflector&, bool& rightAtNotch, bool& middleAtNotch)
+ {
+ rightAtNotch = r[N -1].atNotch();
+ middleAtNotch = r[N -2].atNotch();
+ uint32_t moved =1u << (N -1);
+
+ // Middle steps if it or right is at notch
+ if (middleAtNotch || rightAtNotch)
+ {
+ r[N -2].step();
+ moved |=1u << (N -2);
+ }
+ // Left steps if middle was at notch
+ if (middleAtNotch)
  {
- m_left = left; m_middle = middle; m_right = right;
+ r[N -3].step();
+ moved |=1u << (N -3);
+ }
+ // Right always steps
+ r[N -1].step();
+ return moved;
  }
- void setReflector(const Reflector& r) { m_reflector = r; }
- void setPlugboard(const Plugboard& p) { m_plug = p; }
 
- // Encrypt a single uppercase letter (A..Z). Other characters should be filtered by caller.
- char encryptChar(char c)
- {
- stepRotors();
- int x = ch2i(c);
- x = m_plug.map(x);
- x = m_right.forward(x);
- x = m_middle.forward(x);
- x = m_left.forward(x);
- x = m_reflector.map(x);
- x = m_left.backward(x);
- x = m_middle.backward(x);
- x = m_right.backward(x);
- x = m_plug.map(x);
- return i2ch(x);
+ // The double step makes the left/middle/right offsets a functional graph rather than an odometer, so the
+ // table enumerates it: all 26^3 states, with the cycles they end up on stored in stepping order. A state off
+ // every cycle (e.g. the middle rotor parked on its notch by hand) is stepped plainly until it joins one,
+ // which takes at most a couple of letters.
+ template <int N>
+ class SeekTable
+ {
+ public:
+ template <class Machine>
+ explicit SeekTable(const Machine& em)
+ : m_middleMask(em.rotor(N -2).notchMask()), m_rightMask(em.rotor(N -1).notchMask()),
+ m_where(kStates, -1), m_cycleOf(kStates, 0)
+ {
+ std::vector<uint8_t> color(kStates, 0); //0 new,1 on the current walk,2 done
+ std::vector<int> walk;
+ for (int s0 =0; s0 < kStates; ++s0)
+ {
+ if (color[(size_t)s0]) continue;
+ walk.clear();
+ int s = s0;
+ while (!color[(size_t)s])
+ {
+ color[(size_t)s] =1;
+ walk.push_back(s);
+ s = next(s);
+ }
+ if (color[(size_t)s] ==1)
+ {
+ // s closes a new cycle: the tail of the walk from s on
+ size_t k = walk.size();
+ while (walk[k -1] != s) --k;
+ const uint16_t id = (uint16_t)(m_begin.size());
+ m_begin.push_back((uint32_t)m_cycles.size());
+ for (size_t i = k -1; i < walk.size(); ++i)
+ {
+ m_where[(size_t)walk[i]] = (int32_t)m_cycles.size();
+ m_cycleOf[(size_t)walk[i]] = id;
+ m_cycles.push_back((uint16_t)walk[i]);
+ }
+ }
+ for (int w : walk) color[(size_t)w] =2;
+ }
+ m_begin.push_back((uint32_t)m_cycles.size());
+ }
+
+ void seek(int* offsets, uint64_t letters) const
+ {
+ int s = (offsets[N -3] *26 + offsets[N -2]) *26 + offsets[N -1];
+ while (letters && m_where[(size_t)s] <0) { s = next(s); --letters; }
+ if (letters)
+ {
+ const uint32_t id = m_cycleOf[(size_t)s];
+ const uint64_t begin = m_begin[id], len = m_begin[id +1] - begin;
+ const uint64_t at = ((uint64_t)m_where[(size_t)s] - begin + letters % len) % len;
+ s = m_cycles[(size_t)(begin + at)];
+ }
+ offsets[N -3] = s /676; offsets[N -2] = s /26 %26; offsets[N -1] = s %26;
+ }
+
+ // Length of the stepping cycle through these offsets (0 if they are not on one)
+ uint64_t period(const int* offsets) const
+ {
+ int s = (offsets[N -3] *26 + offsets[N -2]) *26 + offsets[N -1];
+ if (m_where[(size_t)s] <0) return 0;
+ const uint32_t id = m_cycleOf[(size_t)s];
+ return m_begin[id +1] - m_begin[id];
+ }
+
+ private:
+ static const int kStates =26 *26 *26;
+
+ int next(int s) const
+ {
+ int l = s /676, m = s /26 %26, r = s %26;
+ const bool rightAt = (m_rightMask >> r) &1u, middleAt = (m_middleMask >> m) &1u;
+ if (rightAt || middleAt) m = m ==25 ?0 : m +1;
+ if (middleAt) l = l ==25 ?0 : l +1;
+ r = r ==25 ?0 : r +1;
+ return (l *26 + m) *26 + r;
+ }
+
+ uint32_t m_middleMask, m_rightMask;
+ std::vector<int32_t> m_where; // state -> index in m_cycles, -1 if not on a cycle
+ std::vector<uint16_t> m_cycleOf; // state -> cycle number
+ std::vector<uint16_t> m_cycles; // all cycles, each in stepping order
+ std::vector<uint32_t> m_begin; // cycle number -> first index in m_cycles (plus end)
+ };
+ };
+
+ // Cog (gear) drive as in the Abwehr Enigma G: every rotor is geared to its left neighbour, which moves one
+ // step whenever the rotor itself moves past one of its (many) notches. There is no double step, so the machine
+ // is a plain odometer and a seek is arithmetic: over t moves a rotor at offset o passes (t / 26) * notches
+ // + notchesIn[o, o + t % 26) notches, and that is how often its neighbour moves. With MovesReflector the
+ // leftmost rotor drives the reflector as well (Enigma G); otherwise the reflector stays where it was set.
+ template <bool MovesReflector>
+ struct BasicCogStepping
+ {
+ static constexpr int stationaryRotors(int) { return 0; }
+ static const bool kMovesReflector = MovesReflector;
+ static const uint64_t kSeekBuildCost =0;
+
+ template <size_t N>
+ static constexpr uint32_t step(Rotor (&r)[N], Reflector& reflector, bool& rightAtNotch, bool& middleAtNotch)
+ {
+ bool carry = true;
+ uint32_t moved =0;
+ for (size_t i = N; i-- >0; )
+ {
+ const bool at = carry && r[i].atNotch();
+ if (carry)
+ {
+ r[i].step();
+ moved |=1u << i;
+ }
+ if (i == N -1) rightAtNotch = at;
+ if (i == N -2) middleAtNotch = at;
+ carry = at;
+ }
+ if (MovesReflector && carry)
+ {
+ reflector.step();
+ moved |=1u << N;
+ }
+ return moved;
+ }
+
+ template <int N>
+ class SeekTable
+ {
+ public:
+ template <class Machine>
+ explicit SeekTable(const Machine& em)
+ {
+ for (int i =0; i < N; ++i)
+ {
+ const uint32_t mask = em.rotor(i).notchMask();
+ m_prefix[i][0] =0;
+ for (int o =0; o <52; ++o) m_prefix[i][o +1] = (uint8_t)(m_prefix[i][o] + ((mask >> (o %26)) &1u));
+ }
  }
 
- // Utility to encrypt a whole string (letters only are transformed)
- std::string encrypt(const std::string& s)
+ void seek(int* offsets, uint64_t letters) const
  {
- std::string out; out.reserve(s.size());
- for (char c : s)
+ uint64_t t = letters;
+ for (int i = N -1; i >=0 && t; --i)
  {
- if (std::isalpha(static_cast<unsigned char>(c)))
+ const int o = offsets[i], part = (int)(t %26);
+ const uint64_t carries = (t /26) * m_prefix[i][26] + (uint64_t)(m_prefix[i][o + part] - m_prefix[i][o]);
+ offsets[i] = (o + part) %26;
+ t = carries;
+ }
+ if (MovesReflector) offsets[N] = (int)((offsets[N] + t %26) %26);
+ }
+
+ private:
+ uint8_t m_prefix[N][53]; // m_prefix[i][k]: notches of rotor i at offsets0..k-1 (offsets taken mod26)
+ };
+ };
+
+ typedef BasicCogStepping<false> CogStepping;
+ typedef BasicCogStepping<true> RotatingReflectorStepping; // Enigma G
+
+ // Rotors First..First+Count-1 in signal order, unrolled at compile time.
+ template <int First, int Count>
+ struct RotorChain
  {
- out.push_back(encryptChar(static_cast<char>(std::toupper(static_cast<unsigned char>(c)))));
+ template <class Rotors> static constexpr int forward(const Rotors& r, int x) { return RotorChain<First, Count -1>::forward(r, r[First + Count -1].forward(x)); }
+ template <class Rotors> static constexpr int backward(const Rotors& r, int x) { return RotorChain<First +1, Count -1>::backward(r, r[First].backward(x)); }
+ };
+ template <int First>
+ struct RotorChain<First,0>
+ {
+ template <class Rotors> static constexpr int forward(const Rotors&, int x) { return x; }
+ template <class Rotors> static constexpr int backward(const Rotors&, int x) { return x; }
+ };
+
+ // Word-at-a-time check for ASCII letters among sizeof(uint64_t) / sizeof(CharT) code units, so that encrypt can
+ // skip runs without letters (spaces, digits, punctuation, non-Latin UTF-8 or UTF-16) without testing each unit.
+ // It may report a letter that is not there (a unit above 0xFF whose low byte spells one), never miss one; the
+ // caller tests each unit of a word that may have letters.
+ template <class CharT>
+ struct AsciiLetterScan
+ {
+ enum : size_t { kUnits = sizeof(uint64_t) / sizeof(CharT) };
+ static constexpr uint64_t lanes(uint64_t v)
+ {
+ uint64_t r =0;
+ for (size_t i =0; i < kUnits; ++i) r |= v << (i *8 * sizeof(CharT));
+ return r;
  }
- else
+ static bool mayHaveLetters(const CharT* p)
  {
- out.push_back(c);
+ uint64_t v; std::memcpy(&v, p, sizeof(v));
+ // Low seven bits of each unit folded to lower case; adding (0x80 - bound) sets bit 7 where y >= bound
+ // and cannot carry out of the unit
+ const uint64_t y = (v & lanes(0x7F)) | lanes(0x20);
+ const uint64_t atLeastA = y + lanes(0x80 - 'a');
+ const uint64_t pastZ = y + lanes(0x80 - 'z' -1);
+ return (atLeastA & ~pastZ & ~v & lanes(0x80)) !=0;
  }
+ };
+
+ // N-rotor machine; rotors are ordered left to right (index0 leftmost, N-1 the fast right rotor).
+ // How the rotors move is the Stepping policy. With the default ratchet the pawls drive the right three rotors
+ // only: rotors0..N-4 (the M4 Greek wheel) are set by hand and never step, so together with the reflector they
+ // form a fixed involution that is precomputed (m_turn) whenever one of them changes.
+ // BasicEnigmaMachineN<3, P> does exactly the work of the former3-rotor machine.
+ template <int N, class Probe, class Stepping = RatchetStepping>
+ class BasicEnigmaMachineN : private Probe
+ {
+ static_assert(N >=3, "the stepping mechanism drives three rotors");
+ public:
+ typedef Stepping SteppingPolicy;
+ typedef typename Stepping::template SeekTable<N> SeekTable;
+ static const int kRotors = N;
+ static const int kStationary = Stepping::stationaryRotors(N); // leftmost rotors that never step
+
+ constexpr BasicEnigmaMachineN() { rebuildTurnaround(); rebuildEntry(); }
+
+ // The three stepping rotors (for M4: left, middle, right behind the Greek wheel)
+ constexpr void setRotors(const Rotor& left, const Rotor& middle, const Rotor& right)
+ {
+ m_rotors[N -3] = left; m_rotors[N -2] = middle; m_rotors[N -1] = right;
+ }
+ // Any rotor by slot, e.g. setRotor(0, RotorBeta()) for the M4 Greek wheel
+ constexpr void setRotor(int i, const Rotor& r)
+ {
+ m_rotors[(size_t)i] = r;
+ if (i < kStationary) rebuildTurnaround();
+ }
+ constexpr void setReflector(const Reflector& r) { m_reflector = r; rebuildTurnaround(); }
+ constexpr void setPlugboard(const Plugboard& p) { m_plug = p; rebuildEntry(); }
+ constexpr void setEntryWheel(const EntryWheel& e) { m_entry = e; rebuildEntry(); }
+
+ // Encrypt a single uppercase letter (A..Z). Other characters should be filtered by caller.
+ constexpr char encryptChar(char c)
+ {
+ // ch2i gives -1 for anything else, which mod26 turns into Z as before
+ return static_cast<char>('A' + encryptIndex(mod26(ch2i(c))));
+ }
+
+ // Encrypt a single letter index (0..25). Used by paths that already hold letters as indices (e.g. packed text).
+ // The stationary rotors are part of the kStageReflector stage.
+ constexpr int encryptIndex(int x)
+ {
+ uint32_t moved =0;
+ return encryptIndex(x, moved);
+ }
+ // The same, also reporting what the key press moved (see unstep)
+ constexpr int encryptIndex(int x, uint32_t& moved)
+ {
+ Probe::letterBegin();
+ moved = stepRotors();
+ Probe::stageDone(kStageStep);
+ x = m_in[(size_t)x];
+ Probe::stageDone(kStagePlugIn);
+ x = RotorChain<kStationary, N - kStationary>::forward(m_rotors, x);
+ Probe::stageDone(kStageRotorsForward);
+ x = turnaround(x);
+ Probe::stageDone(kStageReflector);
+ x = RotorChain<kStationary, N - kStationary>::backward(m_rotors, x);
+ Probe::stageDone(kStageRotorsBackward);
+ x = m_out[(size_t)x];
+ Probe::stageDone(kStagePlugOut);
+ return x;
  }
+
+ // Encrypt a whole string: ASCII letters (either case) become upper-case cipher letters, every other code unit
+ // is copied. For any character type, so UTF-8 in a std::string and UTF-16/32 text in wide strings are encrypted
+ // without conversion: multi-byte UTF-8 sequences and surrogates are made of units >= 0x80 and pass through.
+ template <class CharT>
+ std::basic_string<CharT> encrypt(const std::basic_string<CharT>& s)
+ {
+ std::basic_string<CharT> out(s);
+ if (!out.empty()) encryptInPlace(&out[0], out.size());
  return out;
  }
+ std::string encrypt(const char* s) { return encrypt(std::string(s)); }
+
+ // The same in place, on n code units
+ template <class CharT>
+ void encryptInPlace(CharT* s, size_t n)
+ {
+ const size_t units = AsciiLetterScan<CharT>::kUnits;
+ size_t i =0;
+ for (; i + units <= n; i += units)
+ {
+ if (!AsciiLetterScan<CharT>::mayHaveLetters(s + i)) continue;
+ for (size_t j = i; j < i + units; ++j) encryptUnit(s[j]);
+ }
+ for (; i < n; ++i) encryptUnit(s[i]);
+ }
 
  // Accessor to positions for UI
- int leftPos() const { return m_left.position(); }
- int midPos() const { return m_middle.position(); }
- int rightPos() const { return m_right.position(); }
+ constexpr int leftPos() const { return m_rotors[N -3].position(); }
+ constexpr int midPos() const { return m_rotors[N -2].position(); }
+ constexpr int rightPos() const { return m_rotors[N -1].position(); }
+
+ // Component accessors (snapshots, diagnostics)
+ constexpr const Rotor& rotor(int i) const { return m_rotors[(size_t)i]; }
+ constexpr const Rotor& leftRotor() const { return m_rotors[N -3]; }
+ constexpr const Rotor& middleRotor() const { return m_rotors[N -2]; }
+ constexpr const Rotor& rightRotor() const { return m_rotors[N -1]; }
+ constexpr const Reflector& reflector() const { return m_reflector; }
+ // Reflector with the stationary rotors folded in. A moving reflector is applied directly: rebuilding the
+ // table each time it steps would cost more than it saves.
+ constexpr int turnaround(int i) const { return Stepping::kMovesReflector ? m_reflector.map(i) : m_turn[(size_t)i]; }
+ constexpr const Plugboard& plugboard() const { return m_plug; }
+ constexpr const EntryWheel& entryWheel() const { return m_entry; }
+ constexpr int entryIn(int key) const { return m_in[(size_t)key]; } // plugboard, then entry wheel
+ constexpr int entryOut(int contact) const { return m_out[(size_t)contact]; } // entry wheel back, then plugboard
 
- void setPositions(int left, int mid, int right)
+ // Instrumentation probe (counters/timers when instantiated with one from EnigmaProbe.h)
+ Probe& probe() { return *this; }
+ const Probe& probe() const { return *this; }
+
+ constexpr void setPositions(int left, int mid, int right)
  {
- m_left.setPosition(left);
- m_middle.setPosition(mid);
- m_right.setPosition(right);
+ m_rotors[N -3].setPosition(left);
+ m_rotors[N -2].setPosition(mid);
+ m_rotors[N -1].setPosition(right);
+ }
+ constexpr void setPosition(int i, int p)
+ {
+ m_rotors[(size_t)i].setPosition(p);
+ if (i < kStationary) rebuildTurnaround();
+ }
+
+ // One key press without encrypting. Returns what moved: bit i for rotor i, bit N for the reflector.
+ constexpr uint32_t step() { return stepRotors(); }
+
+ // Take one key press back: `moved` is what step() or encryptIndex reported for it. Undoing key presses in
+ // reverse order restores every earlier state exactly, double steps included. The machine cannot work this
+ // out from its positions alone, because the double step is not one-to-one: with the middle rotor just
+ // past its notch, (l, m, r) can have come from (l, m, r-1) or, by a double step, from (l-1, m-1, r-1).
+ constexpr void unstep(uint32_t moved)
+ {
+ for (int i = kStationary; i < N; ++i)
+ {
+ if ((moved >> i) &1u) m_rotors[(size_t)i].unstep();
+ }
+ if (Stepping::kMovesReflector && ((moved >> N) &1u)) m_reflector.unstep();
+ }
+
+ // Move the rotors (and a moving reflector) as if `letters` letters had been typed, without encrypting.
+ // Long moves build a SeekTable for the current notches; pass one in to reuse it across seeks.
+ void advance(uint64_t letters)
+ {
+ if (letters <= Stepping::kSeekBuildCost)
+ {
+ while (letters--) stepRotors();
+ return;
+ }
+ advance(letters, SeekTable(*this));
+ }
+ void advance(uint64_t letters, const SeekTable& table)
+ {
+ int offsets[N +1];
+ for (int i =0; i < N; ++i) offsets[i] = m_rotors[(size_t)i].offset();
+ offsets[N] = m_reflector.offset();
+ table.seek(offsets, letters);
+ for (int i = kStationary; i < N; ++i) m_rotors[(size_t)i].setPosition(offsets[i] + m_rotors[(size_t)i].ring());
+ if (Stepping::kMovesReflector) m_reflector.setPosition(offsets[N] + m_reflector.ring());
  }
 
  private:
- // Implements the historical double-stepping for3-rotor machine
- void stepRotors()
+ template <class CharT>
+ void encryptUnit(CharT& c)
  {
- bool rightAtNotch = m_right.atNotch();
- bool middleAtNotch = m_middle.atNotch();
+ const int x = ch2i(c);
+ if (x >=0) c = static_cast<CharT>('A' + encryptIndex(x));
+ }
 
- // Middle steps if it or right is at notch
- if (middleAtNotch || rightAtNotch)
- m_middle.step();
- // Left steps if middle was at notch
- if (middleAtNotch)
- m_left.step();
- // Right always steps
- m_right.step();
+ constexpr uint32_t stepRotors()
+ {
+ bool rightAtNotch = false, middleAtNotch = false;
+ const uint32_t moved = Stepping::step(m_rotors, m_reflector, rightAtNotch, middleAtNotch);
+ Probe::stepped(rightAtNotch, middleAtNotch);
+ return moved;
+ }
+
+ // Stationary rotors forward, reflector, stationary rotors backward
+ constexpr void rebuildTurnaround()
+ {
+ for (int i =0; i <26; ++i)
+ {
+ int x = i;
+ for (int r = kStationary -1; r >=0; --r) x = m_rotors[(size_t)r].forward(x);
+ x = m_reflector.map(x);
+ for (int r =0; r < kStationary; ++r) x = m_rotors[(size_t)r].backward(x);
+ m_turn[(size_t)i] = x;
+ }
  }
 
- Rotor m_left, m_middle, m_right;
+ // Plugboard and entry wheel folded into one table per direction
+ constexpr void rebuildEntry()
+ {
+ for (int i =0; i <26; ++i)
+ {
+ m_in[(size_t)i] = m_entry.in(m_plug.map(i));
+ m_out[(size_t)i] = m_plug.map(m_entry.out(i));
+ }
+ }
+
+ Rotor m_rotors[N]{};
  Reflector m_reflector;
  Plugboard m_plug;
+ EntryWheel m_entry;
+ int m_turn[26]{};
+ int m_in[26]{}, m_out[26]{};
  };
 
+ template <class Probe>
+ using BasicEnigmaMachine = BasicEnigmaMachineN<3, Probe>;
+
+ typedef BasicEnigmaMachine<NullProbe> EnigmaMachine;
+ typedef BasicEnigmaMachineN<4, NullProbe> EnigmaMachineM4;
+ typedef BasicEnigmaMachineN<3, NullProbe, RotatingReflectorStepping> EnigmaMachineG;
+
+ // Text of a fixed length (with its terminator), as EncryptLiteral returns it.
+ template <size_t Size>
+ struct FixedText
+ {
+ char text[Size]{};
+
+ constexpr const char* c_str() const { return text; }
+ constexpr size_t size() const { return Size -1; }
+ constexpr bool equals(const char* s) const
+ {
+ for (size_t i =0; i < Size; ++i)
+ {
+ if (text[i] != s[i]) return false;
+ }
+ return true;
+ }
+ };
+
+ // encrypt() in a constant expression: the machine is taken by value and stepped through the literal, letters
+ // are encrypted (upper case), everything else is copied. With a constexpr machine the result is part of the
+ // binary, e.g.
+ //   constexpr EnigmaMachine kKey = ...;  // built by a constexpr function from the factories
+ //   constexpr auto kCipher = EncryptLiteral(kKey, "ANGRIFF IM MORGENGRAUEN");
+ template <class Machine, size_t Size>
+ constexpr FixedText<Size> EncryptLiteral(Machine em, const char (&s)[Size])
+ {
+ FixedText<Size> out{};
+ for (size_t i =0; i < Size; ++i) out.text[i] = ch2i(s[i]) >=0 ? em.encryptChar(s[i]) : s[i];
+ return out;
+ }
+
+ // Factories by index, in UI/keysheet order: rotors I..VIII = 0..7, Greek Beta, Gamma = 8, 9, G-I..G-III = 10..12;
+ // reflectors B, C = 0, 1, thin B, thin C = 2, 3, G = 4; entry wheels A..Z = 0, QWERTZU = 1.
+ // Unknown indices give rotor V / reflector B / the A..Z entry wheel.
+ constexpr Rotor RotorByIndex(int idx)
+ {
+ if (idx <0 || idx >= kBuiltinRotorCount) idx =4;
+ return Rotor(BuiltinRotorWiring(idx), NotchBits(BuiltinRotors()[idx].notches), idx);
+ }
+ constexpr Reflector ReflectorByIndex(int idx)
+ {
+ if (idx <0 || idx >= kBuiltinReflectorCount) idx =0;
+ return Reflector(BuiltinReflectorWiring(idx), idx);
+ }
+ constexpr EntryWheel EntryWheelByIndex(int idx)
+ {
+ return idx ==1 ? EntryWheel(BuiltinEntryWheelWiring(1), 1) : EntryWheel();
+ }
+
  // Factory helpers for standard components
- inline Rotor RotorI() { return Rotor(Wiring::fromString("EKMFLGDQVZNTOWYHXUSPAIBRCJ"), ch2i('Q')); }
- inline Rotor RotorII() { return Rotor(Wiring::fromString("AJDKSIRUXBLHWTMCQGZNPYFVOE"), ch2i('E')); }
- inline Rotor RotorIII() { return Rotor(Wiring::fromString("BDFHJLCPRTXVZNYEIWGAKMUSQO"), ch2i('V')); }
- inline Rotor RotorIV() { return Rotor(Wiring::fromString("ESOVPZJAYQUIRHXLNFTGKDCMWB"), ch2i('J')); }
- inline Rotor RotorV() { return Rotor(Wiring::fromString("VZBRGITYUPSDNHLXAWMJQOFECK"), ch2i('Z')); }
-
- inline Reflector ReflectorB() { return Reflector(Wiring::fromString("YRUHQSLDPXNGOKMIEBFZCWVJAT")); }
- inline Reflector ReflectorC() { return Reflector(Wiring::fromString("FVPJIAOYEDRZXWGCTKUQSBNMHL")); }
+ constexpr Rotor RotorI() { return RotorByIndex(0); }
+ constexpr Rotor RotorII() { return RotorByIndex(1); }
+ constexpr Rotor RotorIII() { return RotorByIndex(2); }
+ constexpr Rotor RotorIV() { return RotorByIndex(3); }
+ constexpr Rotor RotorV() { return RotorByIndex(4); }
+ constexpr Rotor RotorVI() { return RotorByIndex(5); }
+ constexpr Rotor RotorVII() { return RotorByIndex(6); }
+ constexpr Rotor RotorVIII() { return RotorByIndex(7); }
+ constexpr Rotor RotorBeta() { return RotorByIndex(8); }
+ constexpr Rotor RotorGamma() { return RotorByIndex(9); }
+ constexpr Rotor RotorGI() { return RotorByIndex(10); }
+ constexpr Rotor RotorGII() { return RotorByIndex(11); }
+ constexpr Rotor RotorGIII() { return RotorByIndex(12); }
+
+ constexpr Reflector ReflectorB() { return ReflectorByIndex(0); }
+ constexpr Reflector ReflectorC() { return ReflectorByIndex(1); }
+ constexpr Reflector ReflectorBThin() { return ReflectorByIndex(2); }
+ constexpr Reflector ReflectorCThin() { return ReflectorByIndex(3); }
+ constexpr Reflector ReflectorG() { return ReflectorByIndex(4); }
+
+ constexpr EntryWheel EntryWheelQwertzu() { return EntryWheelByIndex(1); }
 }
 
 // Extension ideas:
 // - Persist and load configurations (rotor order, ring, positions, plugboard) using a simple file or registry.
 // - Add a lampboard/keyboard visualisation: press keys to light cipher output letters.
 // - Visualize stepping by drawing current rotor window letters and highlight when a notch triggers.
-// - Support additional rotors (VI, VII, VIII) with two notches, and thin reflectors for M4.
 // - Add a configuration dialog with validation and presets for historical keysheets.
@@ -0,0 +1,36 @@
+// EnigmaAlign.h - Cache-line aligned heap objects for per-thread state (C++14)
+//
+// Per-worker state written by one thread and read by others (scheduler deques, top-K slots) must not share
+// a cache line with a neighbour's, or every write invalidates the other core's copy. Declaring such a type
+//
+//   struct alignas(kCacheLineSize) Slot : CacheLineAllocated { ... };
+//
+// pads its size to whole lines, and CacheLineAllocated makes `new Slot` honour that alignment: before C++17
+// operator new only guarantees alignof(max_align_t), so the base over-allocates and aligns by hand.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace EnigmaCore
+{
+	const size_t kCacheLineSize = 64;
+
+	struct CacheLineAllocated
+	{
+		static void* operator new(size_t size)
+		{
+			void* raw = ::operator new(size + sizeof(void*) + kCacheLineSize - 1);
+			uintptr_t at = ((uintptr_t)raw + sizeof(void*) + kCacheLineSize - 1) & ~(uintptr_t)(kCacheLineSize - 1);
+			reinterpret_cast<void**>(at)[-1] = raw; // for operator delete
+			return reinterpret_cast<void*>(at);
+		}
+
+		static void operator delete(void* p)
+		{
+			if (p) ::operator delete(reinterpret_cast<void**>(p)[-1]);
+		}
+	};
+}
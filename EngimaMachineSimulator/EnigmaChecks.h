@@ -0,0 +1,912 @@
+// EnigmaChecks.h - Self-checks of the supporting components, run by EnigmaValidate (C++14)
+//
+// The differential validator (EnigmaValidate.h) covers everything that encrypts. The components around the
+// engines (file formats, parsers, the key searches and their concurrency) have no reference to compare
+// against, so each gets a fixed scenario here instead, built to hit the paths that have broken before:
+// corrupt input, a stop or crash in the middle, several threads at once. A check returns false and says
+// what went wrong in *error.
+//
+// Each check takes a few seconds at most (the search ones enumerate the default key space); EnigmaValidate runs
+// them all before the differential run.
+
+#pragma once
+
+#include "Enigma.h"
+#include "EnigmaComponents.h"
+#include "EnigmaDaemon.h"
+#include "EnigmaKeysheet.h"
+#include "EnigmaMachineCache.h"
+#include "EnigmaPacked.h"
+#include "EnigmaSearch.h"
+#include "EnigmaShardSearch.h"
+#include "EnigmaState.h"
+#include "EnigmaTopK.h"
+#include "EnigmaVectors.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace EnigmaCore
+{
+	struct ComponentCheck
+	{
+		std::string name;
+		std::function<bool(std::string* error)> run;
+	};
+
+	namespace detail
+	{
+		inline bool CheckFailed(std::string* error, const std::string& what)
+		{
+			if (error) *error = what;
+			return false;
+		}
+
+		// An intercept-length ciphertext of a fixed key, for the searches.
+		inline std::string CheckCiphertext(size_t letters)
+		{
+			std::string text;
+			for (size_t i = 0; i < letters; ++i) text.push_back((char)('A' + (i * 7 + i / 5) % 26));
+			MachineState key;
+			KeySpace().decode(123456, key);
+			key.plug[4] = 17; key.plug[17] = 4; // E-R
+			return LoadState(key).encrypt(text);
+		}
+
+		// A search small enough for a check: reflector B, rings at A, a short anneal.
+		inline SearchConfig CheckSearchConfig()
+		{
+			SearchConfig cfg;
+			cfg.ciphertext = CheckCiphertext(180);
+			cfg.topK = 4;
+			cfg.annealIterations = 300;
+			cfg.threads = 0;
+			return cfg;
+		}
+
+		inline bool SameCandidates(const SearchResult& a, const SearchResult& b)
+		{
+			if (a.complete != b.complete || a.candidates.size() != b.candidates.size()) return false;
+			for (size_t i = 0; i < a.candidates.size(); ++i)
+			{
+				const SearchCandidate& x = a.candidates[i];
+				const SearchCandidate& y = b.candidates[i];
+				if (x.key != y.key || x.score != y.score || std::memcmp(x.plug, y.plug, 26) != 0) return false;
+			}
+			return true;
+		}
+
+		inline bool ReadPacked(const std::string& bytes, PackedText& t)
+		{
+			std::istringstream is(bytes);
+			return t.read(is);
+		}
+
+		inline std::string PackedHeader(uint64_t letters)
+		{
+			std::string out("EPK1", 4);
+			for (int i = 0; i < 8; ++i) out.push_back((char)((letters >> (8 * i)) & 0xFF));
+			return out;
+		}
+
+		inline std::string PackedWord(uint64_t w)
+		{
+			std::string out;
+			for (int i = 0; i < 8; ++i) out.push_back((char)((w >> (8 * i)) & 0xFF));
+			return out;
+		}
+
+		// Write/read round trip, rejection of corrupt streams, and a search fed the stored corpus.
+		inline bool CheckPacked(std::string* error)
+		{
+			const std::string cipher = CheckCiphertext(185); // 15 blocks and 5 letters
+			const PackedText text = PackedText::fromString(cipher);
+			std::ostringstream os;
+			text.write(os);
+			PackedText back;
+			if (!ReadPacked(os.str(), back) || back.toString() != cipher || back.letters() != text.letters())
+				return CheckFailed(error, "round trip changed the text");
+			if (PackedText::fromString(cipher + "-1.?").toString() != cipher)
+				return CheckFailed(error, "fromString kept a character that is not a letter");
+
+			PackedText t;
+			if (t.push_back(26) || t.push_back(-1) || !t.empty()) return CheckFailed(error, "push_back accepted a non-letter");
+			if (t.appendBlock(~0ull) || t.appendBlock(31) || !t.empty()) return CheckFailed(error, "appendBlock accepted a non-letter");
+
+			const std::string good = os.str();
+			PackedText kept = text;
+			struct Corrupt { const char* what; std::string bytes; };
+			const Corrupt corrupt[] =
+			{
+				{ "field 31", PackedHeader(1) + PackedWord(31) },
+				{ "field 26 mid-block", PackedHeader(12) + PackedWord((uint64_t)26 << 35) },
+				{ "non-zero unused field", PackedHeader(2) + PackedWord((uint64_t)1 << 10) },
+				{ "non-zero top bits", PackedHeader(12) + PackedWord((uint64_t)1 << 62) },
+				{ "length near SIZE_MAX", PackedHeader(~0ull) + PackedWord(0) },
+				{ "length past the blocks", PackedHeader(1000000) + PackedWord(0) },
+				{ "truncated block", good.substr(0, good.size() - 3) },
+				{ "truncated length", good.substr(0, 9) },
+				{ "wrong magic", "EPK2" + good.substr(4) },
+			};
+			for (const Corrupt& c : corrupt)
+			{
+				if (ReadPacked(c.bytes, kept)) return CheckFailed(error, std::string("read accepted ") + c.what);
+				if (kept.toString() != cipher) return CheckFailed(error, std::string("failed read changed the text: ") + c.what);
+			}
+
+			SearchConfig cfg = CheckSearchConfig();
+			cfg.ciphertext = cipher;
+			const SearchResult plain = KeySearch(cfg).run();
+			cfg.packedCiphertext = back;
+			cfg.ciphertext = "ignored";
+			const SearchResult packed = KeySearch(cfg).run();
+			if (!plain.complete || !SameCandidates(plain, packed))
+				return CheckFailed(error, "search on the stored corpus differs from the search on the string");
+			return true;
+		}
+
+		// Bulk parse of a sheet with malformed lines, the net index they must not touch, and indexed lookup.
+		inline bool CheckKeysheet(std::string* error)
+		{
+			const std::string sheet =
+				"# date     net   ukw  rotors    rings  grund  plugboard\n"
+				"1942-05-17 WOTAN B    IV-II-V   GMY    DKP    AV BS CG DL FU HZ IN KM OW RX\r\n"
+				"\n"
+				"1942-05-17 BAD1  B    IV-II     GMY    DKP\n" // two rotors
+				"1942-13-01 BAD2  B    I-II-III  AAA    AAA\n" // month 13
+				"1942-05-17 BAD3  D    I-II-III  AAA    AAA\n" // no reflector D
+				"1942-05-17 BAD4  B    I-II-IX   AAA    AAA\n" // no rotor IX
+				"1942-05-17 BAD5  B    I-II-III  AA     AAA\n" // two rings
+				"1942-05-17 BAD6  B    I-II-III  AAA    AAA    AB BC\n" // B plugged twice
+				"1942-05-17 BAD7  B    I-II-III  AAA    AAA    ABC\n" // not a pair
+				"1942-05-17 NETNAMEOVER15CHARS B I-II-III AAA AAA\n"
+				"1942-02-31 BAD8  B    I-II-III  AAA    AAA\n" // no 31st of February
+				"1942-04-31 BAD9  B    I-II-III  AAA    AAA\n" // April has 30 days
+				"1900-02-29 BADA  B    I-II-III  AAA    AAA\n" // 1900 was not a leap year
+				"1944-02-29 ADLER B    I-II-III  AAA    AAA\n" // 1944 was
+				"1942-05-18 WOTAN C    I-VIII-III AAA   ZZZ    # comment after the key\n"
+				"1942-05-17 WOTAN B    I-II-III  ABC    XYZ    QW\n" // replaces the first key for the 17th
+				"1943-03-09 TRITON B   Beta-II-IV-I AAAV VVJA\n" // M4: thin B, Beta
+				"1943-03-09 BADB  B    Beta-II-IV-I AAA AAAA\n" // three rings on an M4 line
+				"1943-03-09 BADC  B    II-Beta-IV AAA  AAA\n" // Greek wheel not in front
+				"1942-05-17 TAUBE B    V-IV-III  AAA    AAA";
+			Keysheet ks;
+			const Keysheet::LoadResult res = ks.parse(sheet.data(), sheet.data() + sheet.size());
+			if (res.loaded != 6 || res.rejected != 13 || res.firstBadLine != 4)
+				return CheckFailed(error, "wrong loaded/rejected counts or first bad line");
+			for (const char* bad : { "BAD1", "BAD2", "BAD3", "BAD4", "BAD5", "BAD6", "BAD7", "BAD8", "BAD9", "BADA", "BADB", "BADC", "NETNAMEOVER15CHARS" })
+			{
+				if (ks.findNet(bad) != -1) return CheckFailed(error, std::string("rejected line left net ") + bad + " in the index");
+			}
+
+			const int64_t wotan = ks.findNet("WOTAN"), taube = ks.findNet("TAUBE");
+			if (wotan < 0 || taube < 0 || ks.netName((uint32_t)wotan) != "WOTAN") return CheckFailed(error, "net missing");
+			const KeyRecord* k17 = ks.find(19420517, (uint32_t)wotan);
+			const KeyRecord* k18 = ks.find(19420518, (uint32_t)wotan);
+			if (!k17 || !k18 || !ks.find(19420517, (uint32_t)taube)) return CheckFailed(error, "lookup missed a key");
+			if (ks.find(19420519, (uint32_t)wotan) || ks.find(19420518, (uint32_t)taube)) return CheckFailed(error, "lookup found a key that is not there");
+			const int64_t adler = ks.findNet("ADLER");
+			if (adler < 0 || !ks.find(19440229, (uint32_t)adler)) return CheckFailed(error, "leap day key missing");
+			const uint8_t rotors17[3] = { 0, 1, 2 }, rings17[3] = { 0, 1, 2 }, grund17[3] = { 23, 24, 25 };
+			if (k17->reflector != 0 || std::memcmp(k17->rotors, rotors17, 3) != 0 || std::memcmp(k17->rings, rings17, 3) != 0
+				|| std::memcmp(k17->positions, grund17, 3) != 0)
+				return CheckFailed(error, "later key for the same day did not replace the earlier one");
+			for (int i = 0; i < 26; ++i)
+			{
+				const int expected = i == 16 ? 22 : i == 22 ? 16 : i; // Q-W
+				if (k17->plug[i] != expected) return CheckFailed(error, "wrong plugboard");
+			}
+			if (k18->reflector != 1 || k18->rotors[1] != 7 || k18->positions[0] != 25) return CheckFailed(error, "wrong fields");
+			const int64_t triton = ks.findNet("TRITON");
+			const KeyRecord* m4 = triton < 0 ? nullptr : ks.find(19430309, (uint32_t)triton);
+			if (!m4 || m4->greek != 8 || m4->reflector != 2
+				|| BuildMachineM4(*m4).encrypt(std::string("VONVONJLOOKSJHFFTTTE")) != "XLJOGOKMPYOZGFZKHMYQ")
+				return CheckFailed(error, "M4 key does not give the M4 golden vector");
+			return true;
+		}
+
+		// Machine-state records: round trip, a version 1 record that is only wrong in its reserved bytes, and an M4.
+		inline bool CheckState(std::string* error)
+		{
+			MachineState key, back;
+			KeySpace().decode(987654, key);
+			key.plug[0] = 25; key.plug[25] = 0; // A-Z
+			uint8_t rec[kMachineStateSize];
+			EncodeState(key, rec);
+			if (!DecodeState(rec, back) || std::memcmp(&back, &key, sizeof(key)) != 0)
+				return CheckFailed(error, "round trip changed the state");
+			uint8_t fresh[kMachineStateSize];
+			EncodeState(MachineState(), fresh); // what a document without a key saves
+			if (!DecodeState(fresh, back) || LoadState(back).encrypt("AAAAA") != "BDZGO")
+				return CheckFailed(error, "default state is not the I-II-III key with nothing plugged");
+			for (int i = 42; i < 44; ++i)
+			{
+				uint8_t bad[kMachineStateSize];
+				std::memcpy(bad, rec, kMachineStateSize);
+				bad[i] = 1;
+				const uint32_t h = StateChecksum(bad, 44); // a well-formed record apart from the reserved byte
+				for (int j = 0; j < 4; ++j) bad[44 + j] = (uint8_t)(h >> (8 * j));
+				if (DecodeState(bad, back)) return CheckFailed(error, "record with a non-zero reserved byte accepted");
+			}
+
+			// M4: the Greek wheel and thin reflector survive a version 2 record; three-rotor paths refuse it.
+			EnigmaMachineM4 m4 = GoldenVectors::M4();
+			m4.encrypt(std::string("NAVAL"));
+			MachineState m4key, m4back;
+			if (!SaveState(m4, m4key) || !IsM4State(m4key)) return CheckFailed(error, "M4 machine not captured");
+			EncodeState(m4key, rec);
+			if (rec[4] != 2 || !DecodeState(rec, m4back) || std::memcmp(&m4back, &m4key, sizeof(m4key)) != 0)
+				return CheckFailed(error, "M4 round trip changed the state");
+			if (LoadStateM4(m4back).encrypt(std::string("GREEK WHEEL")) != m4.encrypt(std::string("GREEK WHEEL")))
+				return CheckFailed(error, "M4 rebuilt from its snapshot encrypts differently");
+			EnigmaMachine m3;
+			if (SaveState(LoadState(m4back), back) || ComponentSet().build(m4back, m3) || MachineCache().get(m4back, m3))
+				return CheckFailed(error, "M4 state accepted as a three-rotor key");
+
+			// Every decodable record builds through ComponentSet (searches, shards) as through LoadState.
+			key.rotors[0] = 7; key.rotors[1] = 5; // VIII-VI-x
+			EncodeState(key, rec);
+			const ComponentSet components;
+			EnigmaMachine built;
+			if (!DecodeState(rec, back) || !components.build(back, built)
+				|| built.encrypt("ROTOR VIII CHECK") != LoadState(back).encrypt("ROTOR VIII CHECK"))
+				return CheckFailed(error, "component set built a rotor VI-VIII record differently");
+			back.rotors[2] = 200;
+			if (components.build(back, built)) return CheckFailed(error, "component set built an unknown rotor id");
+			return true;
+		}
+
+		inline std::string ReadFileBytes(const std::string& path)
+		{
+			std::ifstream f(path, std::ios::binary);
+			return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+		}
+
+		inline void WriteFileBytes(const std::string& path, const std::string& bytes)
+		{
+			std::ofstream f(path, std::ios::binary | std::ios::trunc);
+			f.write(bytes.data(), (std::streamsize)bytes.size());
+		}
+
+		// A search stopped at every epoch and annealing boundary, each time by a stop requested before run() and
+		// resumed by a fresh KeySearch from the "ENGK" checkpoint, must end with the uninterrupted top-K. A
+		// checkpoint of a walk in progress must be rejected once its plugboard or annealing index is corrupted.
+		inline bool CheckSearchResume(std::string* error)
+		{
+			SearchConfig cfg = CheckSearchConfig();
+			const SearchResult reference = KeySearch(cfg).run();
+			if (!reference.complete) return CheckFailed(error, "uninterrupted search did not complete");
+
+			// Layout: magic, version, fingerprint, phase, cursor, count, count * (key, score, plug), annealIndex,
+			// annealIter, curScore, bestScore, curPlug, bestPlug, RNG.
+			const size_t phaseAt = 4 + 2 * 8, annealIndexAt = 4 + 5 * 8 + cfg.topK * (16 + 26);
+			const size_t annealIterAt = annealIndexAt + 8, curPlugAt = annealIndexAt + 32;
+
+			cfg.checkpointPath = "EnigmaChecks-search.engk";
+			std::remove(cfg.checkpointPath.c_str());
+			SearchResult resumed;
+			std::string midWalk; // a checkpoint taken while annealing a candidate
+			int runs = 0;
+			while (!resumed.complete && runs < 10000)
+			{
+				KeySearch search(cfg);
+				search.requestStop();
+				resumed = search.run();
+				if (runs++ == 0 && resumed.complete) return CheckFailed(error, "stop requested before run() was lost");
+				if (!resumed.complete && midWalk.empty())
+				{
+					const std::string bytes = ReadFileBytes(cfg.checkpointPath);
+					if (bytes.size() > curPlugAt && bytes[phaseAt] == 1 && (signed char)bytes[annealIterAt + 7] >= 0)
+						midWalk = bytes;
+				}
+			}
+			if (!SameCandidates(reference, resumed))
+				return CheckFailed(error, "resumed search differs from the uninterrupted one (" + std::to_string(runs) + " runs)");
+			if (midWalk.empty()) return CheckFailed(error, "no stop landed in the annealing phase");
+			struct Corrupt { const char* what; size_t at; char value; };
+			const Corrupt corrupt[] =
+			{
+				{ "none", 0, 'E' },
+				{ "plug 30", curPlugAt, 30 },
+				{ "plug not an involution", curPlugAt, 5 },
+				{ "annealing index past the top-K", annealIndexAt, (char)(cfg.topK + 1) },
+			};
+			for (const Corrupt& c : corrupt)
+			{
+				std::string bytes = midWalk;
+				bytes[c.at] = c.value;
+				WriteFileBytes(cfg.checkpointPath, bytes);
+				KeySearch search(cfg);
+				search.requestStop();
+				search.run();
+				const bool loaded = search.keysDone() == cfg.space.size(); // a rejected checkpoint starts afresh
+				if (loaded != (c.at == 0)) return CheckFailed(error, std::string("checkpoint with corruption '") + c.what + "' " + (loaded ? "accepted" : "rejected"));
+			}
+			std::remove(cfg.checkpointPath.c_str());
+			return true;
+		}
+
+		// Candidates offered from several threads at once, with many tied scores, must merge to the exact top K.
+		inline bool CheckConcurrentTopK(std::string* error)
+		{
+			const unsigned threads = 4;
+			std::mt19937_64 rng(7);
+			for (size_t k : { (size_t)1, (size_t)7, (size_t)64, (size_t)5000 })
+			{
+				std::vector<SearchCandidate> all(20000);
+				for (size_t i = 0; i < all.size(); ++i)
+				{
+					all[i].key = rng();
+					all[i].score = rng() % 500; // ~40 candidates per score: the tie-break decides
+				}
+				ConcurrentTopK<SearchCandidate> collector(k, threads);
+				std::vector<std::thread> pool;
+				for (unsigned t = 0; t < threads; ++t)
+				{
+					pool.emplace_back([&, t]
+					{
+						for (size_t i = t; i < all.size(); i += threads) collector.offer(t, all[i]);
+					});
+				}
+				for (std::thread& t : pool) t.join();
+
+				std::vector<SearchCandidate> expected = all;
+				std::sort(expected.begin(), expected.end(),
+					[](const SearchCandidate& a, const SearchCandidate& b) { return a.betterThan(b); });
+				expected.resize(k);
+				const std::vector<SearchCandidate> got = collector.result();
+				if (got.size() != k) return CheckFailed(error, "wrong number of candidates for k=" + std::to_string(k));
+				for (size_t i = 0; i < k; ++i)
+				{
+					if (got[i].key != expected[i].key || got[i].score != expected[i].score)
+						return CheckFailed(error, "merged top-K differs from the true top K for k=" + std::to_string(k));
+				}
+				if (collector.cutoff() > expected.back().score) return CheckFailed(error, "cutoff above the K-th best score");
+			}
+			return true;
+		}
+
+		template <class Machine>
+		inline bool SamePositions(const Machine& a, const Machine& b)
+		{
+			for (int i = 0; i < Machine::kRotors; ++i)
+			{
+				if (a.rotor(i).position() != b.rotor(i).position()) return false;
+			}
+			return a.reflector().position() == b.reflector().position();
+		}
+
+		template <class Machine>
+		inline void SeekOffsets(const Machine& em, int* offsets)
+		{
+			for (int i = 0; i < Machine::kRotors; ++i) offsets[i] = em.rotor(i).offset();
+			offsets[Machine::kRotors] = em.reflector().offset();
+		}
+
+		// advance(letters), with and without a caller's seek table, against `letters` plain steps.
+		template <class Machine>
+		inline bool CheckAdvanceFrom(const Machine& start, const std::vector<uint64_t>& lengths, const char* what, std::string* error)
+		{
+			const typename Machine::SeekTable table(start);
+			for (uint64_t letters : lengths)
+			{
+				Machine stepped = start, seeked = start, tabled = start;
+				for (uint64_t i = 0; i < letters; ++i) stepped.step();
+				seeked.advance(letters);
+				tabled.advance(letters, table);
+				if (!SamePositions(stepped, seeked) || !SamePositions(stepped, tabled))
+					return CheckFailed(error, std::string("advance(") + std::to_string(letters) + ") differs from stepping for " + what);
+			}
+			return true;
+		}
+
+		// Middle rotor set onto its notch by hand, right rotor where no step could have put it: a ratchet state
+		// that is on no stepping cycle. False if the notches allow none.
+		template <class Machine>
+		inline bool ParkOffCycle(Machine& em)
+		{
+			const int n = Machine::kRotors;
+			for (int m = 0; m < 26 && !em.rotor(n - 2).atNotch(); ++m) em.setPosition(n - 2, m);
+			const typename Machine::SeekTable table(em);
+			for (int r = 0; r < 26; ++r)
+			{
+				em.setPosition(n - 1, r);
+				int offsets[n + 1];
+				SeekOffsets(em, offsets);
+				if (table.period(offsets) == 0) return true;
+			}
+			return false;
+		}
+
+		// Seeking must land where stepping does: ratchet machines (M3, M4, two-notch rotors) from cycle states and
+		// from off-cycle ones, around the length where advance() switches to a table and past the cycle period;
+		// cog machines and the Enigma G, whose seek is arithmetic, past the full odometer period.
+		inline bool CheckAdvance(std::string* error)
+		{
+			const uint64_t build = RatchetStepping::kSeekBuildCost;
+			const std::vector<uint64_t> ratchetLengths = { 0, 1, 2, 3, 26, 677, build - 1, build, build + 1, 3 * build + 11 };
+
+			MachineState st;
+			KeySpace().decode(123456, st);
+			st.rings[0] = 3; st.rings[1] = 17; st.rings[2] = 9;
+			std::vector<EnigmaMachine> m3 = { LoadState(st) };
+			st.rotors[1] = 5; st.rotors[2] = 7; // VI and VIII: two notches each
+			m3.push_back(LoadState(st));
+			EnigmaMachineM4 m4 = GoldenVectors::M4();
+			for (EnigmaMachine& em : m3)
+			{
+				if (!CheckAdvanceFrom(em, ratchetLengths, "M3", error)) return false;
+				EnigmaMachine onCycle = em;
+				onCycle.step(); onCycle.step(); // any state joins its cycle within two letters
+				int offsets[4];
+				SeekOffsets(onCycle, offsets);
+				const uint64_t period = EnigmaMachine::SeekTable(onCycle).period(offsets);
+				if (period == 0) return CheckFailed(error, "M3 not on a stepping cycle after two letters");
+				if (!CheckAdvanceFrom(onCycle, { period, period + 1, 2 * period - 1 }, "M3 over its period", error)) return false;
+				if (!ParkOffCycle(em)) return CheckFailed(error, "no off-cycle M3 state");
+				if (!CheckAdvanceFrom(em, ratchetLengths, "M3 off its cycle", error)) return false;
+			}
+			if (!CheckAdvanceFrom(m4, ratchetLengths, "M4", error)) return false;
+			if (!ParkOffCycle(m4)) return CheckFailed(error, "no off-cycle M4 state");
+			if (!CheckAdvanceFrom(m4, ratchetLengths, "M4 off its cycle", error)) return false;
+
+			const uint64_t odometer = 26 * 26 * 26, withReflector = 26 * odometer;
+			const std::vector<uint64_t> cogLengths = { 0, 1, 25, 26, 27, 677, odometer - 1, odometer + 5, withReflector + 27 };
+			BasicEnigmaMachineN<3, NullProbe, CogStepping> cog;
+			Rotor l = RotorI(), m = RotorVI(), r = RotorGII();
+			l.setRing(4); m.setRing(11); r.setRing(20);
+			cog.setRotors(l, m, r);
+			cog.setReflector(ReflectorB());
+			cog.setPositions(7, 12, 25);
+			EnigmaMachineG g = GoldenVectors::G();
+			Reflector ukw = ReflectorG();
+			ukw.setRing(5);
+			ukw.setPosition(21);
+			g.setReflector(ukw);
+			return CheckAdvanceFrom(cog, cogLengths, "cog stepping", error)
+				&& CheckAdvanceFrom(GoldenVectors::G(), cogLengths, "Enigma G", error)
+				&& CheckAdvanceFrom(g, cogLengths, "Enigma G with a set reflector", error);
+		}
+
+		// A definition file loaded from disk and used in a machine; one bad line in an otherwise good file, for each
+		// rule, rejected with its line number and without touching the registry; UKW-D rewired from 12 and from 13
+		// pairs into reflectors whose wiring is known.
+		inline bool CheckComponentRegistry(std::string* error)
+		{
+			const std::string good =
+				"# kind     name     wiring                      options\n"
+				"\n"
+				"rotor      X1       EKMFLGDQVZNTOWYHXUSPAIBRCJ  Q         # rotor I under another name\n"
+				"reflector  UKW-X    YRUHQSLDPXNGOKMIEBFZCWVJAT\n"
+				"reflector  UKW-D    FOWULAQYSRTEZVBXGJIKDNCPHM  rewirable\n"
+				"entry      ETW-K    QWERTZUIOASDFGHJKPYXCVBNML\n";
+			const std::string path = "EnigmaChecks-components.txt";
+			WriteFileBytes(path, good);
+			ComponentRegistry reg;
+			std::string why;
+			const bool loaded = reg.loadFile(path, &why);
+			std::remove(path.c_str());
+			if (!loaded) return CheckFailed(error, "good definition file rejected: " + why);
+			const int x1 = reg.find(kComponentRotor, "x1"), ukwX = reg.find(kComponentReflector, "UKW-X");
+			const int ukwD = reg.find(kComponentReflector, "ukw-d");
+			if (x1 != kBuiltinRotorCount || ukwX != kBuiltinReflectorCount || ukwD != kBuiltinReflectorCount + 1
+				|| reg.find(kComponentEntryWheel, "ETW-K") != kBuiltinEntryWheelCount)
+				return CheckFailed(error, "loaded components missing or not numbered after the built-in ones");
+			if (reg.info(kComponentRotor, x1).wiring != &BuiltinRotorWiring(0))
+				return CheckFailed(error, "a loaded copy of rotor I does not share its compiled tables");
+
+			const std::string text = "DEFINITIONFILEROTORSMOVEPASTTHEIRNOTCHES";
+			EnigmaMachine loadedMachine, builtinMachine;
+			Rotor loadedRight = reg.rotor(x1), builtinRight = RotorI();
+			loadedRight.setRing(7); builtinRight.setRing(7);
+			loadedMachine.setRotors(RotorII(), RotorIII(), loadedRight);
+			loadedMachine.setReflector(reg.reflector(ukwX));
+			builtinMachine.setRotors(RotorII(), RotorIII(), builtinRight);
+			builtinMachine.setReflector(ReflectorB());
+			if (loadedMachine.encrypt(text) != builtinMachine.encrypt(text))
+				return CheckFailed(error, "machine with loaded components encrypts differently from rotor I and reflector B");
+
+			struct BadFile
+			{
+				const char* line;
+				int lineNo;
+			};
+			const BadFile bad[] = {
+				{ "rotor      X2       EKMFLGDQVZNTOWYHXUSPAIBRCE  Q\n", 3 }, // E twice, no J
+				{ "reflector  UKW-Y    EKMFLGDQVZNTOWYHXUSPAIBRCJ\n", 7 }, // a permutation, not an involution
+				{ "rotor      X2       EKMFLGDQVZNTOWYHXUSPAIBRCJ  Q1\n", 7 },
+				{ "rotor      x1       AJDKSIRUXBLHWTMCQGZNPYFVOE  E\n", 7 }, // X1 again, in other case
+			};
+			for (const BadFile& b : bad)
+			{
+				size_t at = 0;
+				for (int i = 1; i < b.lineNo; ++i) at = good.find('\n', at) + 1;
+				const std::string file = std::string(good).insert(at, b.line);
+				ComponentRegistry fresh;
+				int before[kComponentKindCount];
+				for (int k = 0; k < kComponentKindCount; ++k) before[k] = fresh.count((ComponentKind)k);
+				why.clear();
+				if (fresh.loadText(file, &why)) return CheckFailed(error, std::string("accepted: ") + b.line);
+				if (why.compare(0, 8, "line " + std::to_string(b.lineNo) + ": ") != 0)
+					return CheckFailed(error, std::string("wrong line in '") + why + "' for: " + b.line);
+				for (int k = 0; k < kComponentKindCount; ++k)
+				{
+					if (fresh.count((ComponentKind)k) != before[k]) return CheckFailed(error, "failed load left components behind");
+				}
+				if (fresh.find(kComponentRotor, "X1") != -1 || fresh.find(kComponentReflector, "UKW-X") != -1)
+					return CheckFailed(error, "failed load registered the good lines before the bad one");
+			}
+
+			// UKW-D: 13 pairs of reflector B give B; the 12 pairs of reflector C other than AF, which the UKW-D wiring
+			// pairs itself, give C.
+			// The table belongs to the holder, not to the shared pool, even when it equals a built-in one.
+			RewiredReflector rewired;
+			if (!reg.rewire(ukwD, "AY BR CU DH EQ FS GL IP JX KN MO TZ VW", rewired, &why))
+				return CheckFailed(error, "13-pair rewiring rejected: " + why);
+			for (int i = 0; i < 26; ++i)
+			{
+				if (rewired.reflector().map(i) != ReflectorB().map(i)) return CheckFailed(error, "UKW-D rewired with the pairs of B is not B");
+			}
+			if (&rewired.reflector().wiring() == &ReflectorB().wiring())
+				return CheckFailed(error, "rewired table was taken from the shared pool");
+			if (!reg.rewire(ukwD, "BV CP DJ EI GO HY KR LZ MX NW QT SU", rewired, &why))
+				return CheckFailed(error, "12-pair rewiring rejected: " + why);
+			for (int i = 0; i < 26; ++i)
+			{
+				if (rewired.reflector().map(i) != ReflectorC().map(i)) return CheckFailed(error, "UKW-D rewired with 12 pairs of C is not C");
+			}
+			if (reg.rewire(ukwD, "AY BR CU DH EQ FS GL IP JX KN MO TZ", rewired)) // leaves V and W, not a UKW-D pair
+				return CheckFailed(error, "12 pairs accepted with the wrong two letters left over");
+			if (reg.rewire(ukwX, "AY BR CU DH EQ FS GL IP JX KN MO TZ VW", rewired))
+				return CheckFailed(error, "reflector not marked rewirable was rewired");
+			return true;
+		}
+
+#if defined(__linux__)
+		inline bool SameKeysAndScores(const std::vector<SearchCandidate>& a, const std::vector<SearchCandidate>& b)
+		{
+			if (a.size() != b.size()) return false;
+			for (size_t i = 0; i < a.size(); ++i)
+			{
+				if (a[i].key != b[i].key || a[i].score != b[i].score) return false;
+			}
+			return true;
+		}
+
+		// Run a sharded search and SIGKILL the first `kills` workers seen, from outside, the way the OOM killer
+		// would. Returns the number of workers killed.
+		inline int RunKillingWorkers(const ShardSearchConfig& cfg, int kills, ShardSearchResult& res)
+		{
+			std::atomic<pid_t> coordinator{ 0 };
+			std::atomic<bool> finished{ false };
+			std::thread runner([&]
+			{
+				coordinator = (pid_t)::syscall(SYS_gettid);
+				res = ShardedKeySearch(cfg).run();
+				finished = true;
+			});
+			std::vector<long> killed;
+			while ((int)killed.size() < kills && !finished)
+			{
+				if (pid_t tid = coordinator.load())
+				{
+					std::ifstream children("/proc/self/task/" + std::to_string(tid) + "/children");
+					long pid = 0;
+					while (children >> pid)
+					{
+						if (std::find(killed.begin(), killed.end(), pid) == killed.end() && ::kill((pid_t)pid, SIGKILL) == 0)
+						{
+							killed.push_back(pid);
+							break;
+						}
+					}
+				}
+				::usleep(1000);
+			}
+			runner.join();
+			return (int)killed.size();
+		}
+
+		// A checkpoint write that fails (the temp file cannot be created) or comes up short (the temp file is
+		// /dev/full, so the final flush fails) must leave the previous checkpoint in place, and loadable.
+		inline bool CheckCheckpointWrite(std::string* error)
+		{
+			SearchConfig cfg = CheckSearchConfig();
+			cfg.threads = 1; // several epochs, so a loaded checkpoint shows in keysDone()
+			cfg.checkpointPath = "EnigmaChecks-write.engk";
+			const std::string tmp = cfg.checkpointPath + ".tmp";
+			std::remove(cfg.checkpointPath.c_str());
+			std::remove(tmp.c_str());
+
+			KeySearch first(cfg);
+			first.requestStop();
+			first.run();
+			const uint64_t saved = first.keysDone();
+			const std::string good = ReadFileBytes(cfg.checkpointPath);
+			if (good.empty() || saved >= cfg.space.size()) return CheckFailed(error, "stopped run left no checkpoint mid-enumeration");
+
+			for (int partial = 0; partial < 2; ++partial)
+			{
+				const char* what = partial ? "short" : "failed";
+				const bool made = partial ? ::symlink("/dev/full", tmp.c_str()) == 0 : ::mkdir(tmp.c_str(), 0700) == 0;
+				if (!made) return CheckFailed(error, std::string("cannot set up the ") + what + " write");
+				KeySearch next(cfg);
+				next.requestStop();
+				next.run();
+				if (partial) ::unlink(tmp.c_str());
+				else ::rmdir(tmp.c_str());
+				if (next.keysDone() <= saved) return CheckFailed(error, std::string("checkpoint not loaded before the ") + what + " write");
+				struct stat st;
+				if (::lstat(cfg.checkpointPath.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || ReadFileBytes(cfg.checkpointPath) != good)
+					return CheckFailed(error, std::string("a ") + what + " write replaced the checkpoint");
+			}
+			std::remove(cfg.checkpointPath.c_str());
+			return true;
+		}
+
+		// Forked shard workers reporting through the shared-memory rings must find KeySearch's enumeration
+		// top-K; so must a run whose worker is killed midway and restarted, and two runs at once. A shard killed
+		// more often than it may restart leaves the run incomplete. A child the caller forked itself must still be
+		// there to reap afterwards.
+		inline bool CheckShardSearch(std::string* error)
+		{
+			SearchConfig ref = CheckSearchConfig();
+			ref.annealIterations = 0; // enumeration only, like the shards
+			const SearchResult expected = KeySearch(ref).run();
+
+			ShardSearchConfig cfg;
+			cfg.ciphertext = ref.ciphertext;
+			cfg.topK = ref.topK;
+			cfg.workers = 3;
+
+			const pid_t own = ::fork(); // the embedding program's own child
+			if (own < 0) return CheckFailed(error, "fork failed");
+			if (own == 0) { ::usleep(200 * 1000); ::_exit(7); }
+
+			ShardSearchResult plain = ShardedKeySearch(cfg).run();
+			int status = 0;
+			const bool ownReaped = ::waitpid(own, &status, 0) == own && WIFEXITED(status) && WEXITSTATUS(status) == 7;
+			if (!ownReaped) return CheckFailed(error, "the search reaped a child it did not fork");
+			if (!plain.complete || plain.restarts != 0 || !SameKeysAndScores(plain.candidates, expected.candidates))
+				return CheckFailed(error, "sharded top-K differs from KeySearch's");
+
+			ShardSearchResult killed;
+			if (RunKillingWorkers(cfg, 1, killed) != 1)
+				return CheckFailed(error, "no worker to kill (is /proc/<pid>/task/<tid>/children available?)");
+			if (!killed.complete || killed.restarts != 1 || !SameKeysAndScores(killed.candidates, expected.candidates))
+				return CheckFailed(error, "top-K after a worker crash and restart differs from KeySearch's");
+
+			ShardSearchResult concurrent[2];
+			std::thread other([&] { concurrent[1] = ShardedKeySearch(cfg).run(); });
+			concurrent[0] = ShardedKeySearch(cfg).run();
+			other.join();
+			for (const ShardSearchResult& r : concurrent)
+			{
+				if (!r.complete || !SameKeysAndScores(r.candidates, expected.candidates))
+					return CheckFailed(error, "two sharded searches run at once in one process interfered");
+			}
+
+			cfg.workers = 1;
+			cfg.maxRestartsPerWorker = 1;
+			ShardSearchResult given;
+			if (RunKillingWorkers(cfg, 2, given) != 2 || given.complete || given.restarts != 1)
+				return CheckFailed(error, "a shard killed after its last restart did not fail the run");
+			return true;
+		}
+
+		// The daemon in a child process, so the check can freeze it with SIGSTOP between poll rounds.
+		inline pid_t StartDaemonProcess(const std::string& path)
+		{
+			const pid_t pid = ::fork();
+			if (pid != 0) return pid;
+			EncryptDaemon daemon(path);
+			if (!daemon.start()) ::_exit(3);
+			daemon.run();
+			::_exit(0);
+		}
+
+		inline bool ConnectToDaemon(EncryptClient& client, const std::string& path)
+		{
+			for (int tries = 0; tries < 500; ++tries)
+			{
+				if (client.connect(path)) return true;
+				::usleep(10 * 1000);
+			}
+			return false;
+		}
+
+		// A raw stream socket connected to the daemon, for clients that misbehave; -1 on failure.
+		inline int ConnectRawToDaemon(const std::string& path)
+		{
+			const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			sockaddr_un addr;
+			std::memset(&addr, 0, sizeof(addr));
+			addr.sun_family = AF_UNIX;
+			std::memcpy(addr.sun_path, path.c_str(), path.size());
+			if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return fd;
+			if (fd >= 0) ::close(fd);
+			return -1;
+		}
+
+		// A client sends a frame and disconnects in the same poll round in which the daemon's write to it fails:
+		// the frame is in the batch while the client is closed. The daemon must survive that and keep serving.
+		inline bool CheckDaemonDisconnect(std::string* error)
+		{
+			const std::string path = "/tmp/enigma-check-" + std::to_string((long)::getpid()) + ".sock";
+			const pid_t daemon = StartDaemonProcess(path);
+			if (daemon < 0) return CheckFailed(error, "fork failed");
+			MachineState key;
+			KeySpace().decode(4242, key);
+			bool ok = true;
+			std::string what;
+			{
+				EncryptClient probe;
+				ok = ConnectToDaemon(probe, path);
+				what = "cannot connect";
+			}
+			int fd = -1;
+			if (ok)
+			{
+				// A response larger than the socket buffer, left unread, so the daemon holds queued output.
+				fd = ConnectRawToDaemon(path);
+				const std::string big = DaemonProtocol::encodeRequest(1, key, std::string(4 << 20, 'A'));
+				ok = fd >= 0 && ::send(fd, big.data(), big.size(), MSG_NOSIGNAL) == (ssize_t)big.size();
+				pollfd pfd{ fd, POLLIN, 0 };
+				ok = ok && ::poll(&pfd, 1, 10000) == 1;
+				::usleep(100 * 1000);
+				what = "big request not answered";
+			}
+			if (ok)
+			{
+				// Frozen, the daemon sees all of this in its next round: a new frame, then end of stream, and a peer
+				// whose receive queue was drained before it closed, so the pending write fails with EPIPE.
+				::kill(daemon, SIGSTOP);
+				const std::string frame = DaemonProtocol::encodeRequest(2, key, "HELLO");
+				ok = ::send(fd, frame.data(), frame.size(), MSG_NOSIGNAL) == (ssize_t)frame.size();
+				char buf[65536];
+				while (::recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) {}
+				::close(fd);
+				fd = -1;
+				::kill(daemon, SIGCONT);
+				what = "send failed";
+			}
+			if (ok)
+			{
+				EncryptClient client;
+				std::string out;
+				ok = ConnectToDaemon(client, path) && client.encrypt(key, "ENIGMA CHECK", out) == (int)DaemonProtocol::kStatusOk
+					&& out == LoadState(key).encrypt("ENIGMA CHECK");
+				what = "daemon stopped serving after a client failed mid-batch";
+			}
+			if (fd >= 0) ::close(fd);
+			int status = 0;
+			if (::waitpid(daemon, &status, WNOHANG) != 0)
+			{
+				ok = false;
+				what = "daemon process died";
+			}
+			else
+			{
+				::kill(daemon, SIGKILL);
+				::waitpid(daemon, &status, 0);
+			}
+			::unlink(path.c_str());
+			return ok || CheckFailed(error, what);
+		}
+
+		// A client that pipelines requests without reading must be pushed back on: its sends stall after a
+		// bounded amount instead of the daemon queueing responses for as long as it keeps sending. Once it reads,
+		// every request is answered.
+		inline bool CheckDaemonBackpressure(std::string* error)
+		{
+			const std::string path = "/tmp/enigma-check-bp-" + std::to_string((long)::getpid()) + ".sock";
+			const pid_t daemon = StartDaemonProcess(path);
+			if (daemon < 0) return CheckFailed(error, "fork failed");
+			MachineState key;
+			KeySpace().decode(777, key);
+			const std::string text(64 << 10, 'E');
+			const std::string frame = DaemonProtocol::encodeRequest(1, key, text);
+			const std::string expected = LoadState(key).encrypt(text);
+			const size_t kLimit = 64u << 20; // far above what the daemon may buffer for one client
+			bool ok = false;
+			std::string what = "cannot connect";
+			int fd = -1;
+			{
+				EncryptClient probe;
+				if (ConnectToDaemon(probe, path)) fd = ConnectRawToDaemon(path);
+			}
+			if (fd >= 0)
+			{
+				::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+				size_t sent = 0, answered = 0;
+				std::string in;
+				bool stalled = false;
+				ok = true;
+				// Send without reading until the daemon stops taking requests.
+				while (ok && !stalled && sent < kLimit)
+				{
+					const ssize_t n = ::send(fd, frame.data() + sent % frame.size(), frame.size() - sent % frame.size(), MSG_NOSIGNAL);
+					if (n > 0) { sent += (size_t)n; continue; }
+					if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) { ok = false; what = "send failed"; break; }
+					pollfd pfd{ fd, POLLOUT, 0 };
+					stalled = ::poll(&pfd, 1, 500) == 0;
+				}
+				if (ok && !stalled) { ok = false; what = "daemon kept reading a client that does not read"; }
+				// Finish the last frame and read every response.
+				const size_t frames = (sent + frame.size() - 1) / frame.size();
+				while (ok && answered < frames)
+				{
+					pollfd pfd{ fd, (short)(POLLIN | (sent < frames * frame.size() ? POLLOUT : 0)), 0 };
+					if (::poll(&pfd, 1, 10000) <= 0) { ok = false; what = "responses stopped"; break; }
+					if (pfd.revents & POLLOUT)
+					{
+						const ssize_t n = ::send(fd, frame.data() + sent % frame.size(), frame.size() - sent % frame.size(), MSG_NOSIGNAL);
+						if (n > 0) sent += (size_t)n;
+					}
+					char buf[65536];
+					const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+					if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) { ok = false; what = "daemon closed the client"; break; }
+					if (n > 0) in.append(buf, (size_t)n);
+					size_t pos = 0;
+					while (ok && in.size() - pos >= 16 && in.size() - pos >= 4 + DaemonProtocol::get32(in.data() + pos))
+					{
+						const char* p = in.data() + pos;
+						if (DaemonProtocol::get32(p + 8) != DaemonProtocol::kStatusOk || in.compare(pos + 16, DaemonProtocol::get32(p + 12), expected) != 0)
+						{
+							ok = false;
+							what = "wrong response";
+						}
+						pos += 4 + DaemonProtocol::get32(p);
+						++answered;
+					}
+					in.erase(0, pos);
+				}
+			}
+			if (fd >= 0) ::close(fd);
+			::kill(daemon, SIGKILL);
+			int status = 0;
+			::waitpid(daemon, &status, 0);
+			::unlink(path.c_str());
+			return ok || CheckFailed(error, what);
+		}
+#endif
+	}
+
+	inline std::vector<ComponentCheck> DefaultComponentChecks()
+	{
+		std::vector<ComponentCheck> checks;
+		checks.push_back({ "packed", detail::CheckPacked });
+		checks.push_back({ "keysheet", detail::CheckKeysheet });
+		checks.push_back({ "state", detail::CheckState });
+		checks.push_back({ "search-resume", detail::CheckSearchResume });
+		checks.push_back({ "topk", detail::CheckConcurrentTopK });
+		checks.push_back({ "advance", detail::CheckAdvance });
+		checks.push_back({ "components", detail::CheckComponentRegistry });
+#if defined(__linux__)
+		checks.push_back({ "checkpoint", detail::CheckCheckpointWrite });
+		checks.push_back({ "shard-search", detail::CheckShardSearch });
+		checks.push_back({ "daemon", detail::CheckDaemonDisconnect });
+		checks.push_back({ "backpressure", detail::CheckDaemonBackpressure });
+#endif
+		return checks;
+	}
+}
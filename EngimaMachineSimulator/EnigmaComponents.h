@@ -0,0 +1,289 @@
+// EnigmaComponents.h - Registry of rotors, reflectors and entry wheels, loadable from a definition file (C++14)
+//
+// Definition file: one component per line, whitespace separated, '#' starts a comment.
+//
+//   # kind     name     wiring                      options
+//   rotor      X1       QWERTZUIOASDFGHJKPYXCVBNML  AN        # notch letters, '-' for none
+//   reflector  UKW-X    YRUHQSLDPXNGOKMIEBFZCWVJAT
+//   reflector  UKW-D    FOWULAQYSRTEZVBXGJIKDNCPHM  rewirable # rewired per key with rewire()
+//   entry      ETW-K    QWERTZUIOASDFGHJKPYXCVBNML            # keys in contact order
+//
+// - name: up to 15 characters without whitespace, case-insensitive, unique per kind
+// - wiring: 26 letters forming a permutation; a reflector must also be an involution without fixed points
+//
+// A file is loaded as a whole or not at all: the first invalid line stops the load, and the error names it.
+// The registry starts out with the built-in components (Enigma.h) under the same ids as RotorByIndex,
+// ReflectorByIndex and EntryWheelByIndex, so loaded components get the ids after those. Every wiring is compiled
+// once (CompileWiring): components handed out by the registry, and every copy of them in machines and search
+// workers, point at the same aligned tables. A loaded registry is read-only and may be shared between threads.
+// Rewired UKW-D tables are the exception: every key has its own wiring, so they are compiled into a
+// RewiredReflector owned by the caller rather than into the process-wide pool.
+
+#pragma once
+
+#include "Enigma.h"
+
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace EnigmaCore
+{
+	enum ComponentKind { kComponentRotor, kComponentReflector, kComponentEntryWheel, kComponentKindCount };
+
+	inline const char* ComponentKindName(ComponentKind kind)
+	{
+		static const char* const names[kComponentKindCount] = { "rotor", "reflector", "entry" };
+		return names[kind];
+	}
+
+	struct ComponentInfo
+	{
+		std::string name;
+		const CompiledWiring* wiring{ nullptr };
+		uint32_t notchMask{ 0 }; // rotors
+		bool rewirable{ false }; // reflectors (UKW-D)
+		bool builtin{ false };
+	};
+
+	// A reflector rewired for one key (ComponentRegistry::rewire), with its own compiled table. Machines using
+	// reflector() point at that table, so keep the holder alive and in place while they are in use; rewiring it
+	// again changes them all. Declare it as a local or member: heap copies need 64-byte alignment.
+	class RewiredReflector
+	{
+	public:
+		RewiredReflector() = default;
+		RewiredReflector(const RewiredReflector&) = delete;
+		RewiredReflector& operator=(const RewiredReflector&) = delete;
+
+		const Reflector& reflector() const { return m_reflector; }
+
+	private:
+		friend class ComponentRegistry;
+		CompiledWiring m_table;
+		Reflector m_reflector;
+	};
+
+	class ComponentRegistry
+	{
+	public:
+		ComponentRegistry()
+		{
+			for (int i = 0; i < kBuiltinRotorCount; ++i)
+				addBuiltin(kComponentRotor, BuiltinRotors()[i], BuiltinRotorWiring(i));
+			for (int i = 0; i < kBuiltinReflectorCount; ++i)
+				addBuiltin(kComponentReflector, BuiltinReflectors()[i], BuiltinReflectorWiring(i));
+			for (int i = 0; i < kBuiltinEntryWheelCount; ++i)
+				addBuiltin(kComponentEntryWheel, BuiltinEntryWheels()[i], EntryWheelByIndex(i).wiring());
+		}
+
+		// Load definitions from a file. On failure nothing is added and *error says why.
+		bool loadFile(const std::string& path, std::string* error = nullptr)
+		{
+			std::ifstream f(path.c_str(), std::ios::binary);
+			if (!f)
+			{
+				if (error) *error = "cannot open " + path;
+				return false;
+			}
+			std::stringstream ss;
+			ss << f.rdbuf();
+			return loadText(ss.str(), error);
+		}
+
+		bool loadText(const std::string& text, std::string* error = nullptr)
+		{
+			struct Pending
+			{
+				ComponentKind kind;
+				std::string name, wiring, notches;
+				bool rewirable;
+			};
+			std::vector<Pending> pending;
+			std::istringstream lines(text);
+			std::string line;
+			int lineNo = 0;
+			auto fail = [&](const std::string& why)
+			{
+				if (error) *error = "line " + std::to_string(lineNo) + ": " + why;
+				return false;
+			};
+			while (std::getline(lines, line))
+			{
+				++lineNo;
+				size_t hash = line.find('#');
+				if (hash != std::string::npos) line.erase(hash);
+				std::istringstream tokens(line);
+				std::string kindName, name, wiring, option, extra;
+				if (!(tokens >> kindName)) continue;
+				tokens >> name >> wiring >> option >> extra;
+				Pending p{ kComponentRotor, Upper(name), wiring, std::string(), false };
+				if (kindName == "rotor") p.kind = kComponentRotor;
+				else if (kindName == "reflector") p.kind = kComponentReflector;
+				else if (kindName == "entry") p.kind = kComponentEntryWheel;
+				else return fail("unknown component kind '" + kindName + "'");
+				if (wiring.empty()) return fail("expected: " + kindName + " NAME WIRING ...");
+				if (!extra.empty()) return fail("unexpected '" + extra + "'");
+				if (p.kind == kComponentRotor)
+				{
+					if (option.empty()) return fail("rotor " + p.name + " needs its notch letters ('-' for none)");
+					if (option != "-") p.notches = option;
+				}
+				else if (p.kind == kComponentReflector && option == "rewirable") p.rewirable = true;
+				else if (!option.empty()) return fail("unexpected '" + option + "'");
+
+				std::string why;
+				if (!check(p.kind, p.name, p.wiring, p.notches, why)) return fail(why);
+				for (const Pending& q : pending)
+				{
+					if (q.kind == p.kind && q.name == p.name) return fail(std::string(ComponentKindName(p.kind)) + " " + p.name + " defined twice");
+				}
+				pending.push_back(p);
+			}
+			for (const Pending& p : pending) insert(p.kind, p.name, p.wiring, p.notches, p.rewirable);
+			return true;
+		}
+
+		// Add one component. Returns its id, or -1 (with *error set) if the definition is invalid.
+		int add(ComponentKind kind, const std::string& name, const std::string& wiring, const std::string& notches = std::string(),
+			bool rewirable = false, std::string* error = nullptr)
+		{
+			std::string why;
+			if (!check(kind, Upper(name), wiring, notches, why))
+			{
+				if (error) *error = why;
+				return -1;
+			}
+			return insert(kind, Upper(name), wiring, notches, rewirable && kind == kComponentReflector);
+		}
+
+		// Id by name (case-insensitive), -1 if unknown.
+		int find(ComponentKind kind, const std::string& name) const
+		{
+			auto it = m_byName[kind].find(Upper(name));
+			return it == m_byName[kind].end() ? -1 : it->second;
+		}
+
+		int count(ComponentKind kind) const { return (int)m_items[kind].size(); }
+		const ComponentInfo& info(ComponentKind kind, int id) const { return m_items[kind][(size_t)id]; }
+
+		// Components by id, at position A and ring A. They share the registry's compiled tables.
+		Rotor rotor(int id) const
+		{
+			const ComponentInfo& c = m_items[kComponentRotor][(size_t)id];
+			return Rotor(*c.wiring, c.notchMask, id);
+		}
+		Reflector reflector(int id) const { return Reflector(*m_items[kComponentReflector][(size_t)id].wiring, id); }
+		EntryWheel entryWheel(int id) const { return EntryWheel(*m_items[kComponentEntryWheel][(size_t)id].wiring, id); }
+
+		// Rewire a rewirable reflector (UKW-D) for one key. pairs: 13 letter pairs, or 12 if the two letters left
+		// over are paired in the reflector's own wiring (the UKW-D has one pair that cannot be rewired).
+		// The result has no standard id (-1), so machines using it cannot be snapshotted. On failure out is unchanged.
+		bool rewire(int reflectorId, const std::string& pairs, RewiredReflector& out, std::string* error = nullptr) const
+		{
+			auto fail = [&](const std::string& why)
+			{
+				if (error) *error = why;
+				return false;
+			};
+			const ComponentInfo& base = m_items[kComponentReflector][(size_t)reflectorId];
+			if (!base.rewirable) return fail("reflector " + base.name + " is not rewirable");
+			Wiring w{};
+			for (int& f : w.fwd) f = -1;
+			int pending = -1, letters = 0;
+			for (char ch : pairs)
+			{
+				if (ch == ' ' || ch == '\t' || ch == ',' || ch == '-') continue;
+				int c = ch2i(ch);
+				if (c < 0) return fail(std::string("not a letter: '") + ch + "'");
+				if (w.fwd[(size_t)c] >= 0 || c == pending) return fail(std::string("letter ") + (char)('A' + c) + " used twice");
+				if (pending < 0) { pending = c; continue; }
+				w.fwd[(size_t)pending] = c;
+				w.fwd[(size_t)c] = pending;
+				pending = -1;
+				letters += 2;
+			}
+			if (pending >= 0) return fail("odd number of letters");
+			if (letters == 24)
+			{
+				int a = -1, b = -1;
+				for (int i = 0; i < 26; ++i)
+				{
+					if (w.fwd[(size_t)i] < 0) (a < 0 ? a : b) = i;
+				}
+				if (base.wiring->fwd[a] != b) return fail(std::string("12 pairs given, but ") + (char)('A' + a) + (char)('A' + b) + " is not the fixed pair");
+				w.fwd[(size_t)a] = b;
+				w.fwd[(size_t)b] = a;
+			}
+			else if (letters != 26)
+			{
+				return fail("expected 12 or 13 pairs");
+			}
+			for (int i = 0; i < 26; ++i) w.rev[(size_t)w.fwd[(size_t)i]] = i;
+			out.m_table.compile(w);
+			out.m_reflector = Reflector(out.m_table, -1);
+			return true;
+		}
+
+	private:
+		static std::string Upper(std::string s)
+		{
+			for (char& c : s) c = (char)std::toupper((unsigned char)c);
+			return s;
+		}
+
+		bool check(ComponentKind kind, const std::string& name, const std::string& wiring, const std::string& notches, std::string& why) const
+		{
+			const std::string what = std::string(ComponentKindName(kind)) + " " + name;
+			if (name.empty() || name.size() > 15) { why = "bad name '" + name + "'"; return false; }
+			if (m_byName[kind].count(name)) { why = what + " already exists"; return false; }
+			Wiring w;
+			if (!Wiring::tryParse(wiring, w)) { why = what + ": wiring must be 26 letters, each used once"; return false; }
+			if (kind == kComponentReflector && !w.isInvolution())
+			{
+				why = what + ": reflector wiring must pair every letter with a different one";
+				return false;
+			}
+			for (char c : notches)
+			{
+				if (ch2i(c) < 0) { why = what + ": bad notch letter '" + std::string(1, c) + "'"; return false; }
+			}
+			return true;
+		}
+
+		int insert(ComponentKind kind, const std::string& name, const std::string& wiring, const std::string& notches, bool rewirable)
+		{
+			ComponentInfo c;
+			c.name = name;
+			c.wiring = &CompileWiring(Wiring::fromString(wiring));
+			c.notchMask = NotchBits(notches.c_str());
+			c.rewirable = rewirable;
+			return push(kind, c);
+		}
+
+		void addBuiltin(ComponentKind kind, const BuiltinComponent& def, const CompiledWiring& wiring)
+		{
+			ComponentInfo c;
+			c.name = def.name;
+			c.wiring = &wiring;
+			c.notchMask = NotchBits(def.notches);
+			c.builtin = true;
+			push(kind, c);
+		}
+
+		int push(ComponentKind kind, const ComponentInfo& c)
+		{
+			int id = (int)m_items[kind].size();
+			m_byName[kind].emplace(c.name, id);
+			m_items[kind].push_back(c);
+			return id;
+		}
+
+		std::vector<ComponentInfo> m_items[kComponentKindCount];
+		std::unordered_map<std::string, int> m_byName[kComponentKindCount];
+	};
+}
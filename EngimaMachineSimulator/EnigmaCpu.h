@@ -0,0 +1,118 @@
+// EnigmaCpu.h - CPU identification and feature probing for engine dispatch and reports (C++14)
+//
+// Reads the CPUID brand string on x86/x64 (MSVC intrinsics or GCC/Clang <cpuid.h>) and reports the number of
+// hardware threads. On other architectures the brand is "unknown"; callers only use it as a label.
+//
+// CpuFeatures says which SIMD levels may be used: the CPUID bit alone is not enough for AVX/AVX-512, the OS
+// must also save the wider registers on context switch (OSXSAVE + XCR0), which is checked with xgetbv.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#define ENIGMA_HAVE_CPUID 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define ENIGMA_HAVE_CPUID 1
+#endif
+
+namespace EnigmaCore
+{
+	// regs = { eax, ebx, ecx, edx } for the given leaf/subleaf. Returns false if CPUID is unavailable.
+	inline bool Cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+	{
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#if defined(ENIGMA_HAVE_CPUID) && defined(_MSC_VER)
+		int r[4];
+		__cpuidex(r, (int)leaf, (int)subleaf);
+		for (int i = 0; i < 4; ++i) regs[i] = (uint32_t)r[i];
+		return true;
+#elif defined(ENIGMA_HAVE_CPUID)
+		if (__get_cpuid_max(leaf & 0x80000000u, nullptr) < leaf) return false;
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+		return true;
+#else
+		(void)leaf; (void)subleaf;
+		return false;
+#endif
+	}
+
+	// Extended control register XCR0 (which register states the OS saves), 0 if unavailable.
+	inline uint64_t ReadXcr0()
+	{
+#if defined(ENIGMA_HAVE_CPUID) && defined(_MSC_VER)
+		return (uint64_t)_xgetbv(0);
+#elif defined(ENIGMA_HAVE_CPUID)
+		uint32_t lo, hi;
+		__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return ((uint64_t)hi << 32) | lo;
+#else
+		return 0;
+#endif
+	}
+
+	struct CpuFeatures
+	{
+		bool sse41{ false };
+		bool avx2{ false };
+		bool avx512f{ false };
+		bool avx512bw{ false };
+	};
+
+	// Probed once; usable-by-this-process levels only.
+	inline const CpuFeatures& QueryCpuFeatures()
+	{
+		static const CpuFeatures features = []
+		{
+			CpuFeatures f;
+			uint32_t r[4];
+			if (!Cpuid(1, 0, r)) return f;
+			f.sse41 = (r[2] >> 19) & 1;
+			const bool osxsave = (r[2] >> 27) & 1;
+			const uint64_t xcr0 = osxsave ? ReadXcr0() : 0;
+			const bool osAvx = (xcr0 & 0x6) == 0x6; // SSE and AVX state
+			const bool osAvx512 = (xcr0 & 0xe6) == 0xe6; // plus opmask and ZMM state
+			if (Cpuid(7, 0, r))
+			{
+				f.avx2 = osAvx && ((r[1] >> 5) & 1);
+				f.avx512f = osAvx512 && ((r[1] >> 16) & 1);
+				f.avx512bw = f.avx512f && ((r[1] >> 30) & 1);
+			}
+			return f;
+		}();
+		return features;
+	}
+
+	struct CpuInfo
+	{
+		std::string brand; // e.g. "Intel(R) Core(TM) i7-..." or "unknown"
+		unsigned hardwareThreads{ 1 };
+	};
+
+	inline CpuInfo QueryCpuInfo()
+	{
+		CpuInfo info;
+		uint32_t regs[4];
+		char brand[49] = {};
+		if (Cpuid(0x80000000u, 0, regs) && regs[0] >= 0x80000004u)
+		{
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				Cpuid(0x80000002u + i, 0, regs);
+				std::memcpy(brand + 16 * i, regs, 16);
+			}
+		}
+		const char* b = brand;
+		while (*b == ' ') ++b;
+		info.brand = *b ? b : "unknown";
+		info.hardwareThreads = std::thread::hardware_concurrency();
+		if (info.hardwareThreads == 0) info.hardwareThreads = 1;
+		return info;
+	}
+}
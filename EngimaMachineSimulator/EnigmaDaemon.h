@@ -0,0 +1,410 @@
+// EnigmaDaemon.h - Local batching encryption daemon over a Unix domain socket (Linux, C++14)
+//
+// Services that need many small encrypt/decrypt calls talk to one long-lived process instead of building a
+// machine per call. The daemon caches ready-to-run machines by key (MachineCache), so a request costs a hash
+// lookup, a machine copy and the letters.
+//
+// Protocol (all integers little-endian), one frame per request on a stream socket:
+//   request:  u32 payloadLength | u32 requestId | u8 op | u8 reserved[3] | 48-byte MachineState record
+//             (EncodeState format, EnigmaState.h) | u32 textLength | text bytes
+//   response: u32 payloadLength | u32 requestId | u32 status | u32 textLength | text bytes
+// payloadLength counts the bytes after the length field. op 0 = encrypt (Enigma is reciprocal, so this also
+// decrypts). Letters are transformed exactly as EnigmaMachine::encrypt does; everything else passes through.
+// Keys are three-rotor states; an M4 state (EnigmaState.h) is answered with kStatusBadKey.
+//
+// Each poll() round reads every complete frame from every ready client into one batch. The batch is grouped
+// by key, so requests that share a key hit the machine cache once. Its texts are then encrypted in one
+// EngineDispatcher::encryptMessages call (EnigmaDispatch.h), and responses are queued per client.
+// Clients that fail during the round are closed only after the batch, which may still point at them; their
+// responses are dropped. The daemon is single-threaded; clients may pipeline several requests on one connection.
+//
+// A client that pipelines faster than it reads is pushed back on: at most kMaxReadPerRound bytes are read from
+// it per round, and it is not read at all while more than kMaxPendingOutput bytes of its responses are unsent.
+// Its requests then wait in the socket, so the daemon's memory per client stays bounded.
+
+#pragma once
+
+#if defined(__linux__)
+
+#include "Enigma.h"
+#include "EnigmaDispatch.h"
+#include "EnigmaMachineCache.h"
+#include "EnigmaState.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace EnigmaCore
+{
+	namespace DaemonProtocol
+	{
+		const uint8_t kOpEncrypt = 0;
+		const uint32_t kStatusOk = 0;
+		const uint32_t kStatusBadKey = 1;
+		const uint32_t kStatusBadRequest = 2;
+		const uint32_t kMaxPayload = 16u << 20;
+		const size_t kRequestHeader = 4 + 4 + 4 + kMachineStateSize + 4; // through textLength
+
+		inline void put32(std::string& out, uint32_t v) { for (int i = 0; i < 4; ++i) out.push_back((char)((v >> (8 * i)) & 0xFF)); }
+		inline uint32_t get32(const char* p)
+		{
+			const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+			return (uint32_t)u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) | ((uint32_t)u[3] << 24);
+		}
+
+		inline std::string encodeRequest(uint32_t requestId, const MachineState& key, const std::string& text)
+		{
+			std::string out;
+			put32(out, (uint32_t)(kRequestHeader - 4 + text.size()));
+			put32(out, requestId);
+			out.push_back((char)kOpEncrypt);
+			out.append(3, '\0');
+			uint8_t rec[kMachineStateSize];
+			EncodeState(key, rec);
+			out.append(reinterpret_cast<const char*>(rec), kMachineStateSize);
+			put32(out, (uint32_t)text.size());
+			out += text;
+			return out;
+		}
+	}
+
+	class EncryptDaemon
+	{
+	public:
+		explicit EncryptDaemon(const std::string& socketPath, size_t maxCachedKeys = 4096)
+			: m_path(socketPath), m_cache(maxCachedKeys)
+		{
+		}
+
+		~EncryptDaemon()
+		{
+			for (Client& c : m_clients) ::close(c.fd);
+			if (m_listen >= 0)
+			{
+				::close(m_listen);
+				::unlink(m_path.c_str());
+			}
+		}
+
+		// Bind and listen. Replaces a stale socket file at the same path.
+		bool start()
+		{
+			if (m_path.size() >= sizeof(sockaddr_un().sun_path)) return false;
+			m_listen = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (m_listen < 0) return false;
+			sockaddr_un addr;
+			std::memset(&addr, 0, sizeof(addr));
+			addr.sun_family = AF_UNIX;
+			std::memcpy(addr.sun_path, m_path.c_str(), m_path.size());
+			::unlink(m_path.c_str());
+			if (::bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(m_listen, 128) != 0)
+			{
+				::close(m_listen);
+				m_listen = -1;
+				return false;
+			}
+			setNonBlocking(m_listen);
+			return true;
+		}
+
+		// Serve until requestStop() is called (checked at least every 100 ms).
+		void run()
+		{
+			std::vector<pollfd> fds;
+			while (!m_stop.load(std::memory_order_relaxed))
+			{
+				fds.clear();
+				fds.push_back(pollfd{ m_listen, POLLIN, 0 });
+				for (const Client& c : m_clients)
+				{
+					const bool readable = !c.eof && c.out.size() <= kMaxPendingOutput;
+					fds.push_back(pollfd{ c.fd, (short)((readable ? POLLIN : 0) | (c.out.empty() ? 0 : POLLOUT)), 0 });
+				}
+				if (::poll(fds.data(), fds.size(), 100) <= 0) continue;
+
+				if (fds[0].revents & POLLIN) acceptClients();
+				size_t i = 1;
+				for (auto it = m_clients.begin(); it != m_clients.end(); ++i)
+				{
+					// Clients accepted this round are past the end of fds.
+					short ev = (i < fds.size() && fds[i].fd == it->fd) ? fds[i].revents : 0;
+					bool ok = true;
+					if (!it->eof && (ev & (POLLIN | POLLHUP | POLLERR))) ok = readClient(*it);
+					if (ok && (ev & POLLOUT)) ok = flushClient(*it);
+					it->failed = !ok; // kept until after processBatch: frames read this round point at it
+					++it;
+				}
+				processBatch();
+				for (auto it = m_clients.begin(); it != m_clients.end();)
+				{
+					// A client that shut down its write side is closed once its responses are out.
+					if (it->failed || !flushClient(*it) || (it->eof && it->out.empty()))
+					{
+						::close(it->fd);
+						it = m_clients.erase(it);
+					}
+					else
+						++it;
+				}
+			}
+		}
+
+		void requestStop() { m_stop.store(true, std::memory_order_relaxed); }
+
+		uint64_t requestsServed() const { return m_served; }
+		uint64_t batches() const { return m_batches; }
+		uint64_t cacheHits() const { return m_cache.hits(); }
+
+	private:
+		static const size_t kMaxPendingOutput = 4u << 20; // unsent response bytes above which a client is not read
+		static const size_t kMaxReadPerRound = 1u << 20; // request bytes read from one client per poll round
+
+		struct Client
+		{
+			int fd{ -1 };
+			std::string in;
+			std::string out; // responses not yet sent
+			bool eof{ false };
+			bool failed{ false }; // closed at the end of this poll round
+		};
+
+		struct Pending
+		{
+			Client* client;
+			uint32_t requestId;
+			std::string key; // raw 48-byte record, used for grouping and as the cache key
+			std::string text;
+			uint32_t status;
+		};
+
+		static void setNonBlocking(int fd) { ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK); }
+
+		void acceptClients()
+		{
+			for (;;)
+			{
+				int fd = ::accept(m_listen, nullptr, nullptr);
+				if (fd < 0) return;
+				setNonBlocking(fd);
+				Client c;
+				c.fd = fd;
+				m_clients.push_back(std::move(c));
+			}
+		}
+
+		// Read what is available, up to kMaxReadPerRound, and queue complete frames. Returns false if the client
+		// failed or misbehaved.
+		bool readClient(Client& c)
+		{
+			char buf[65536];
+			for (size_t got = 0; got < kMaxReadPerRound;)
+			{
+				ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+				if (n > 0) { c.in.append(buf, (size_t)n); got += (size_t)n; continue; }
+				if (n == 0) { c.eof = true; break; }
+				if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+				if (errno == EINTR) continue;
+				return false;
+			}
+			using namespace DaemonProtocol;
+			std::vector<Pending> frames;
+			size_t pos = 0;
+			while (c.in.size() - pos >= 4)
+			{
+				uint32_t len = get32(c.in.data() + pos);
+				if (len > kMaxPayload || len < kRequestHeader - 4) return false;
+				if (c.in.size() - pos - 4 < len) break;
+				const char* p = c.in.data() + pos + 4;
+				Pending r;
+				r.client = &c;
+				r.requestId = get32(p);
+				r.key.assign(p + 8, kMachineStateSize);
+				uint32_t textLen = get32(p + 8 + kMachineStateSize);
+				r.status = (p[4] == (char)kOpEncrypt && textLen == len - (kRequestHeader - 4)) ? kStatusOk : kStatusBadRequest;
+				if (r.status == kStatusOk) r.text.assign(p + kRequestHeader - 4, textLen);
+				frames.push_back(std::move(r));
+				pos += 4 + len;
+			}
+			c.in.erase(0, pos);
+			for (Pending& r : frames) m_batch.push_back(std::move(r));
+			return true;
+		}
+
+		// Send what the socket takes and drop it from c.out, so a client that never fully drains does not keep
+		// its sent responses. Returns false if the client failed.
+		bool flushClient(Client& c)
+		{
+			size_t sent = 0;
+			bool ok = true;
+			while (sent < c.out.size())
+			{
+				ssize_t n = ::send(c.fd, c.out.data() + sent, c.out.size() - sent, MSG_NOSIGNAL);
+				if (n > 0) { sent += (size_t)n; continue; }
+				if (n < 0 && errno == EINTR) continue;
+				ok = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+				break;
+			}
+			c.out.erase(0, sent);
+			return ok;
+		}
+
+		void processBatch()
+		{
+			if (m_batch.empty()) return;
+			++m_batches;
+			// Group by key so each distinct key is looked up once per batch. Stable, so the responses of one
+			// client keep their request order.
+			std::vector<Pending*> order;
+			order.reserve(m_batch.size());
+			for (Pending& p : m_batch) order.push_back(&p);
+			std::stable_sort(order.begin(), order.end(), [](const Pending* a, const Pending* b) { return a->key < b->key; });
+
+			// One machine at its key's start position per request, then the whole batch as many messages.
+			std::vector<Pending*> valid;
+			m_machines.clear();
+			m_texts.clear();
+			EnigmaMachine proto;
+			bool protoOk = false;
+			const std::string* protoKey = nullptr;
+			for (Pending* p : order)
+			{
+				if (p->status == DaemonProtocol::kStatusOk && !p->client->failed)
+				{
+					if (!protoKey || *protoKey != p->key)
+					{
+						protoOk = machineFor(p->key, proto);
+						protoKey = &p->key;
+					}
+					if (protoOk)
+					{
+						valid.push_back(p);
+						m_machines.push_back(proto);
+						m_texts.push_back(std::move(p->text));
+					}
+					else
+						p->status = DaemonProtocol::kStatusBadKey;
+				}
+			}
+			m_results.resize(valid.size());
+			EngineDispatcher::instance().encryptMessages(m_machines.data(), m_texts.data(), m_results.data(), valid.size());
+			for (size_t i = 0; i < valid.size(); ++i) valid[i]->text.swap(m_results[i]);
+			m_texts.clear();
+			// Responses in arrival order.
+			for (Pending& p : m_batch)
+			{
+				if (p.client->failed) continue;
+				if (p.status != DaemonProtocol::kStatusOk) p.text.clear();
+				std::string& out = p.client->out;
+				DaemonProtocol::put32(out, (uint32_t)(12 + p.text.size()));
+				DaemonProtocol::put32(out, p.requestId);
+				DaemonProtocol::put32(out, p.status);
+				DaemonProtocol::put32(out, (uint32_t)p.text.size());
+				out += p.text;
+				++m_served;
+			}
+			m_batch.clear();
+		}
+
+		// The machine at the key's start position; false if the record is invalid.
+		bool machineFor(const std::string& key, EnigmaMachine& em)
+		{
+			MachineState st;
+			return DecodeState(reinterpret_cast<const uint8_t*>(key.data()), st) && m_cache.get(st, em);
+		}
+
+		std::string m_path;
+		int m_listen{ -1 };
+		std::atomic<bool> m_stop{ false };
+		std::list<Client> m_clients; // stable addresses for Pending::client
+		std::vector<Pending> m_batch;
+		std::vector<EnigmaMachine> m_machines; // processBatch's dispatcher input and output, kept for capacity
+		std::vector<std::string> m_texts, m_results;
+
+		MachineCache m_cache;
+
+		uint64_t m_served{ 0 }, m_batches{ 0 };
+	};
+
+	// Minimal blocking client for the daemon protocol.
+	class EncryptClient
+	{
+	public:
+		~EncryptClient() { close(); }
+
+		bool connect(const std::string& socketPath)
+		{
+			close();
+			sockaddr_un addr;
+			if (socketPath.size() >= sizeof(addr.sun_path)) return false;
+			m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (m_fd < 0) return false;
+			std::memset(&addr, 0, sizeof(addr));
+			addr.sun_family = AF_UNIX;
+			std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size());
+			if (::connect(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) { close(); return false; }
+			return true;
+		}
+
+		void close()
+		{
+			if (m_fd >= 0) ::close(m_fd);
+			m_fd = -1;
+		}
+
+		// Returns the daemon status (DaemonProtocol::kStatusOk on success), or -1 on a transport error.
+		int encrypt(const MachineState& key, const std::string& text, std::string& out)
+		{
+			std::string req = DaemonProtocol::encodeRequest(++m_nextId, key, text);
+			if (!sendAll(req.data(), req.size())) return -1;
+			char hdr[16];
+			if (!recvAll(hdr, sizeof(hdr))) return -1;
+			uint32_t id = DaemonProtocol::get32(hdr + 4), status = DaemonProtocol::get32(hdr + 8), len = DaemonProtocol::get32(hdr + 12);
+			if (id != m_nextId || len > DaemonProtocol::kMaxPayload) return -1;
+			out.resize(len);
+			if (len && !recvAll(&out[0], len)) return -1;
+			return (int)status;
+		}
+
+	private:
+		bool sendAll(const char* p, size_t n)
+		{
+			while (n > 0)
+			{
+				ssize_t k = ::send(m_fd, p, n, MSG_NOSIGNAL);
+				if (k < 0 && errno == EINTR) continue;
+				if (k <= 0) return false;
+				p += k; n -= (size_t)k;
+			}
+			return true;
+		}
+
+		bool recvAll(char* p, size_t n)
+		{
+			while (n > 0)
+			{
+				ssize_t k = ::recv(m_fd, p, n, 0);
+				if (k < 0 && errno == EINTR) continue;
+				if (k <= 0) return false;
+				p += k; n -= (size_t)k;
+			}
+			return true;
+		}
+
+		int m_fd{ -1 };
+		uint32_t m_nextId{ 0 };
+	};
+}
+
+#endif // __linux__
@@ -0,0 +1,331 @@
+// EnigmaDispatch.h - Runtime selection of the fastest encryption engine (C++14)
+//
+// Callers describe the work, not the engine:
+// - stream:        one key, one text (encrypt);
+// - many messages: one key per text (encryptMessages);
+// - many keys:     one letter text under many keys, e.g. scoring search candidates (encryptManyKeys).
+//
+// EngineDispatcher probes CPUID once (EnigmaCpu.h) to find which engines may run: the reference EnigmaMachine,
+// TableEngine, and BatchEngineAvx2 when AVX2 is usable. SSE4.1 and AVX-512 are probed and reported, but no
+// engine needs them yet. No shape is decided by rule, because every crossover depends on the CPU (gather
+// throughput, for instance, varies a lot between cores and microcode, and the reference machine comes close to
+// TableEngine on long streams). Instead a tiny calibration run times every candidate on synthetic keys at the
+// same shape and length bucket, and the result is cached for the rest of the process. Every decision is kept
+// with its reason and timings for diagnostics().
+//
+// Hot loops that run one shape many times (the key search) choose() once and pass the engine to the static
+// encryptManyKeys overload, which takes no lock.
+//
+// All engines produce byte-identical output to EnigmaMachine, so dispatch never changes results.
+
+#pragma once
+
+#include "Enigma.h"
+#include "EnigmaCpu.h"
+#include "EnigmaEngines.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace EnigmaCore
+{
+	enum EngineKind { kEngineReference, kEngineTable, kEngineAvx2Batch, kEngineCount };
+	enum InputShape { kShapeStream, kShapeManyMessages, kShapeManyKeys, kShapeCount };
+
+	inline const char* EngineName(EngineKind e)
+	{
+		static const char* const names[kEngineCount] = { "reference", "table", "avx2Batch" };
+		return (e >= 0 && e < kEngineCount) ? names[e] : "?";
+	}
+
+	inline const char* ShapeName(InputShape s)
+	{
+		static const char* const names[kShapeCount] = { "stream", "manyMessages", "manyKeys" };
+		return (s >= 0 && s < kShapeCount) ? names[s] : "?";
+	}
+
+	struct DispatchDecision
+	{
+		InputShape shape{ kShapeStream };
+		size_t lengthBucket{ 0 }; // letters per item, rounded up to a power of two
+		EngineKind engine{ kEngineReference };
+		bool calibrated{ false };
+		double nsPerLetter[kEngineCount]{}; // calibration timings, 0 = not measured
+		std::string reason;
+	};
+
+	class EngineDispatcher
+	{
+	public:
+		// Process-wide dispatcher; CPU features are probed on first use.
+		static EngineDispatcher& instance()
+		{
+			static EngineDispatcher dispatcher;
+			return dispatcher;
+		}
+
+		EngineDispatcher() : m_features(QueryCpuFeatures()) {}
+
+		EngineDispatcher(const EngineDispatcher&) = delete;
+		EngineDispatcher& operator=(const EngineDispatcher&) = delete;
+
+		const CpuFeatures& features() const { return m_features; }
+
+		bool supports(EngineKind e) const
+		{
+			if (e == kEngineAvx2Batch)
+			{
+#if defined(ENIGMA_HAVE_AVX2_ENGINE)
+				return m_features.avx2;
+#else
+				return false;
+#endif
+			}
+			return e == kEngineReference || e == kEngineTable;
+		}
+
+		// Pin one engine (e.g. to reproduce a problem); kEngineCount restores automatic choice.
+		// Shapes the pinned engine cannot run fall back to automatic choice. Forced choices are not recorded
+		// as decisions; diagnostics() reports the pin itself.
+		void force(EngineKind e)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_forced = e;
+		}
+
+		// Engine that will run `shape` with items of `letters` letters. May run a calibration the first time.
+		EngineKind choose(InputShape shape, size_t letters)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return decide(shape, letters).engine;
+		}
+
+		// Stream: encrypt text with em and advance em, exactly like em.encrypt(text).
+		std::string encrypt(EnigmaMachine& em, const std::string& text)
+		{
+			std::string out;
+			runMessages(choose(kShapeStream, text.size()), &em, &text, &out, 1);
+			return out;
+		}
+
+		// Many messages: out[i] = machines[i].encrypt(texts[i]); every machine is advanced.
+		void encryptMessages(EnigmaMachine* machines, const std::string* texts, std::string* out, size_t n)
+		{
+			if (n == 0) return;
+			std::vector<size_t> lengths(n);
+			for (size_t i = 0; i < n; ++i) lengths[i] = texts[i].size();
+			std::nth_element(lengths.begin(), lengths.begin() + n / 2, lengths.end());
+			runMessages(choose(kShapeManyMessages, lengths[n / 2]), machines, texts, out, n);
+		}
+
+		// Many keys: out[k*len + i] = letter i of `text` (indices 0..25) under machines[k]. Machines are not advanced.
+		void encryptManyKeys(const EnigmaMachine* machines, size_t n, const uint8_t* text, size_t len, uint8_t* out)
+		{
+			if (n == 0) return;
+			encryptManyKeys(choose(kShapeManyKeys, len), machines, n, text, len, out);
+		}
+
+		// Many keys on an engine returned by choose(kShapeManyKeys, len). Takes no lock, so worker threads and
+		// forked processes can call it once per batch.
+		static void encryptManyKeys(EngineKind e, const EnigmaMachine* machines, size_t n, const uint8_t* text, size_t len, uint8_t* out)
+		{
+			if (n < kMinBatchKeys && e == kEngineAvx2Batch) e = kEngineTable; // mostly empty lanes
+			runManyKeys(e, machines, n, text, len, out);
+		}
+
+		std::vector<DispatchDecision> decisions() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::vector<DispatchDecision> out;
+			for (const auto& d : m_decisions) out.push_back(d.second);
+			return out;
+		}
+
+		// {"cpu":{...},"engines":{...},"forced":...,"decisions":[...]} for logs and benchmark reports.
+		std::string diagnostics() const
+		{
+			char buf[256];
+			std::string out = "{";
+			std::snprintf(buf, sizeof(buf), "\"cpu\":{\"sse41\":%s,\"avx2\":%s,\"avx512f\":%s,\"avx512bw\":%s},\"engines\":{",
+				b(m_features.sse41), b(m_features.avx2), b(m_features.avx512f), b(m_features.avx512bw));
+			out += buf;
+			for (int e = 0; e < kEngineCount; ++e)
+			{
+				std::snprintf(buf, sizeof(buf), "%s\"%s\":%s", e ? "," : "", EngineName((EngineKind)e), b(supports((EngineKind)e)));
+				out += buf;
+			}
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::snprintf(buf, sizeof(buf), "},\"forced\":%s%s%s,\"decisions\":[", m_forced < kEngineCount ? "\"" : "",
+				m_forced < kEngineCount ? EngineName(m_forced) : "null", m_forced < kEngineCount ? "\"" : "");
+			out += buf;
+			bool first = true;
+			for (const auto& kv : m_decisions)
+			{
+				const DispatchDecision& d = kv.second;
+				std::snprintf(buf, sizeof(buf), "%s{\"shape\":\"%s\",\"lengthBucket\":%llu,\"engine\":\"%s\",\"calibrated\":%s,\"nsPerLetter\":{",
+					first ? "" : ",", ShapeName(d.shape), (unsigned long long)d.lengthBucket, EngineName(d.engine), b(d.calibrated));
+				out += buf;
+				bool firstTiming = true;
+				for (int e = 0; e < kEngineCount; ++e)
+				{
+					if (d.nsPerLetter[e] <= 0.0) continue;
+					std::snprintf(buf, sizeof(buf), "%s\"%s\":%.3f", firstTiming ? "" : ",", EngineName((EngineKind)e), d.nsPerLetter[e]);
+					out += buf;
+					firstTiming = false;
+				}
+				out += "},\"reason\":\"" + d.reason + "\"}";
+				first = false;
+			}
+			out += "]}";
+			return out;
+		}
+
+		// Run a shape on a given engine (also used by benchmarks and validation to compare engines).
+		static void runMessages(EngineKind e, EnigmaMachine* machines, const std::string* texts, std::string* out, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				if (e == kEngineReference)
+				{
+					out[i] = machines[i].encrypt(texts[i]);
+					continue;
+				}
+				TableEngine te(machines[i]);
+				out[i] = te.encrypt(texts[i]);
+				te.store(machines[i]);
+			}
+		}
+
+		static void runManyKeys(EngineKind e, const EnigmaMachine* machines, size_t n, const uint8_t* text, size_t len, uint8_t* out)
+		{
+#if defined(ENIGMA_HAVE_AVX2_ENGINE)
+			if (e == kEngineAvx2Batch)
+			{
+				BatchEngineAvx2::encryptManyKeys(machines, n, text, len, out);
+				return;
+			}
+#endif
+			for (size_t k = 0; k < n; ++k)
+			{
+				if (e == kEngineReference)
+				{
+					EnigmaMachine em = machines[k];
+					for (size_t i = 0; i < len; ++i) out[k * len + i] = (uint8_t)em.encryptIndex(text[i]);
+				}
+				else
+				{
+					TableEngine(machines[k]).encryptIndices(text, out + k * len, len);
+				}
+			}
+		}
+
+	private:
+		static const size_t kMinBucket = 16, kMaxBucket = 4096;
+		static const size_t kMinBatchKeys = 4; // below this the AVX2 batch runs mostly empty lanes
+		static const size_t kCalibrationLetters = 8192; // per candidate and repetition
+
+		static const char* b(bool v) { return v ? "true" : "false"; }
+
+		static size_t bucketOf(size_t letters)
+		{
+			size_t bucket = kMinBucket;
+			while (bucket < letters && bucket < kMaxBucket) bucket *= 2;
+			return bucket;
+		}
+
+		DispatchDecision decide(InputShape shape, size_t letters)
+		{
+			std::vector<EngineKind> candidates;
+			candidates.push_back(kEngineReference);
+			candidates.push_back(kEngineTable);
+			if (shape == kShapeManyKeys && supports(kEngineAvx2Batch)) candidates.push_back(kEngineAvx2Batch);
+
+			DispatchDecision d;
+			d.shape = shape;
+			if (m_forced < kEngineCount && std::find(candidates.begin(), candidates.end(), m_forced) != candidates.end())
+			{
+				d.engine = m_forced;
+				d.reason = "forced";
+				return d;
+			}
+			const size_t bucket = bucketOf(letters);
+			auto it = m_decisions.find(std::make_pair((int)shape, bucket));
+			if (it != m_decisions.end()) return it->second;
+
+			d.lengthBucket = bucket;
+			d.calibrated = true;
+			calibrate(shape, bucket, candidates, d);
+			m_decisions.insert(std::make_pair(std::make_pair((int)shape, bucket), d));
+			return d;
+		}
+
+		// Time each candidate on synthetic keys: `bucket` letters per item, about kCalibrationLetters in total.
+		void calibrate(InputShape shape, size_t bucket, const std::vector<EngineKind>& candidates, DispatchDecision& d)
+		{
+			const size_t items = shape == kShapeStream ? 1 : (std::max)((size_t)8, kCalibrationLetters / bucket);
+			std::vector<EnigmaMachine> machines(items);
+			for (size_t k = 0; k < items; ++k)
+			{
+				int r = (int)k;
+				Rotor rotors[3] = { RotorByIndex(r % 5), RotorByIndex((r + 1) % 5), RotorByIndex((r + 3) % 5) };
+				for (int i = 0; i < 3; ++i)
+				{
+					rotors[i].setRing(r * (i + 3));
+					rotors[i].setPosition(r * (i + 7));
+				}
+				machines[k].setRotors(rotors[0], rotors[1], rotors[2]);
+				machines[k].setReflector(ReflectorByIndex(r & 1));
+				Plugboard plug;
+				for (int p = 0; p < 10; ++p) plug.connect((r + p * 5) % 26, (r + p * 5 + 2) % 26);
+				machines[k].setPlugboard(plug);
+			}
+			std::vector<uint8_t> letters(bucket);
+			std::string text(bucket, 'A');
+			for (size_t i = 0; i < bucket; ++i)
+			{
+				letters[i] = (uint8_t)((i * 7 + i / 26) % 26);
+				text[i] = (char)('A' + letters[i]);
+			}
+			std::vector<std::string> texts(items, text), outs(items);
+			std::vector<uint8_t> out(items * bucket);
+			const int reps = shape == kShapeStream ? (int)(std::max)((size_t)1, kCalibrationLetters / bucket) : 1;
+
+			double best = 0.0;
+			for (EngineKind e : candidates)
+			{
+				double t = 1e300;
+				for (int trial = 0; trial < 3; ++trial)
+				{
+					std::vector<EnigmaMachine> ms(machines);
+					auto t0 = std::chrono::steady_clock::now();
+					for (int r = 0; r < reps; ++r)
+					{
+						if (shape == kShapeManyKeys) runManyKeys(e, ms.data(), items, letters.data(), bucket, out.data());
+						else runMessages(e, ms.data(), texts.data(), outs.data(), items);
+					}
+					auto t1 = std::chrono::steady_clock::now();
+					t = (std::min)(t, std::chrono::duration<double, std::nano>(t1 - t0).count());
+				}
+				d.nsPerLetter[e] = t / ((double)reps * (double)items * (double)bucket);
+				if (best == 0.0 || d.nsPerLetter[e] < best)
+				{
+					best = d.nsPerLetter[e];
+					d.engine = e;
+				}
+			}
+			d.reason = "calibrated";
+		}
+
+		CpuFeatures m_features;
+		mutable std::mutex m_mutex;
+		EngineKind m_forced{ kEngineCount };
+		std::map<std::pair<int, size_t>, DispatchDecision> m_decisions;
+	};
+}
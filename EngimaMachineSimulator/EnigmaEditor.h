@@ -0,0 +1,125 @@
+// EnigmaEditor.h - The interactive encryption path: a plaintext, its ciphertext and the key, kept in step (C++14)
+//
+// A CipherEditor is what the document and view do between a key press and the ciphertext on screen, without
+// the window: the plaintext (a PieceTable, EnigmaText.h), the key, and an IncrementalSession (EnigmaSession.h)
+// holding the ciphertext. The document delegates to one, and EnigmaBench replays editing sessions through one,
+// so the latencies it reports are those of the view's own code path.
+//
+// How the ciphertext follows an edit or a new key depends on the strategy:
+// - kFullReencrypt encrypts the whole plaintext again after every change (what the view first did);
+// - kIncremental re-encrypts an edit from where it starts (IncrementalSession::apply) and a new key at once;
+// - kBackground is kIncremental, except that a new key on a long text, or a long paste, leaves the ciphertext
+//   out of date for a worker thread to rebuild (EnigmaWorker.h). Edits meanwhile change only the plaintext;
+//   endSetKey() takes the session the worker built from key() and plaintext().
+//
+//   CipherEditor editor;
+//   Patch change = editor.edit(patch); // how the ciphertext changed
+//   if (!editor.setKey(key)) worker.submit(editor.key(), editor.plaintext().str());
+
+#pragma once
+
+#include "Enigma.h"
+#include "EnigmaSession.h"
+#include "EnigmaText.h"
+
+#include <string>
+#include <utility>
+
+namespace EnigmaCore
+{
+	enum class EditorStrategy
+	{
+		kFullReencrypt,
+		kIncremental,
+		kBackground,
+	};
+
+	template <class Machine, class CharT = char>
+	class BasicCipherEditor
+	{
+	public:
+		typedef BasicIncrementalSession<Machine, CharT> Session;
+		typedef typename Session::String String;
+		typedef typename Session::Patch Patch;
+		typedef typename Session::Text Text;
+
+		// kBackground: texts at least this long are encrypted on the worker when the key changes or they are pasted
+		static const size_t kDefaultBackgroundChars = 256 * 1024;
+
+		explicit BasicCipherEditor(EditorStrategy strategy = EditorStrategy::kBackground, size_t backgroundChars = kDefaultBackgroundChars)
+			: m_strategy(strategy), m_backgroundChars(backgroundChars ? backgroundChars : 1)
+		{
+		}
+
+		// Replace the whole text (a document being loaded) and encrypt it under the current key.
+		void load(String text)
+		{
+			m_plain.assign(std::move(text));
+			reencrypt();
+		}
+
+		// Edit the plaintext. Returns how the ciphertext changed (nothing while it is out of date).
+		Patch edit(const Patch& edit)
+		{
+			if (edit.empty()) return Patch();
+			if (m_strategy == EditorStrategy::kBackground && !m_stale && edit.inserted.size() >= m_backgroundChars)
+				m_stale = true;
+			m_plain.apply(edit);
+			if (m_stale) return Patch();
+			if (m_strategy == EditorStrategy::kFullReencrypt) return reencrypt();
+			return m_session.apply(edit);
+		}
+		Patch setText(const CharT* text, size_t n) { return edit(m_plain.diff(text, n)); }
+
+		// Encrypt the plaintext under a new key. Returns false if that is left to the worker (isCipherCurrent()
+		// is false until endSetKey).
+		bool setKey(const Machine& key)
+		{
+			m_key = key;
+			if (m_strategy == EditorStrategy::kBackground && m_plain.size() >= m_backgroundChars)
+			{
+				m_stale = true;
+				return false;
+			}
+			if (m_stale || m_strategy == EditorStrategy::kFullReencrypt)
+				reencrypt(); // the session missed the edits since the ciphertext went out of date
+			else
+				m_session.setKey(key);
+			return true;
+		}
+
+		// The worker's session for key() and plaintext() as they were when it was submitted, and still are.
+		void endSetKey(Session& session)
+		{
+			std::swap(m_session, session);
+			m_stale = false;
+		}
+
+		bool isCipherCurrent() const { return !m_stale; }
+		EditorStrategy strategy() const { return m_strategy; }
+		const Machine& key() const { return m_key; }
+		const Text& plaintext() const { return m_plain; }
+		const String& ciphertext() const { return m_session.ciphertext(); } // out of date unless isCipherCurrent()
+
+	private:
+		Patch reencrypt()
+		{
+			Patch change;
+			change.removed = m_session.ciphertext().size();
+			m_session.reset(m_key);
+			m_session.setText(m_plain.str());
+			change.inserted = m_session.ciphertext();
+			m_stale = false;
+			return change;
+		}
+
+		EditorStrategy m_strategy;
+		size_t m_backgroundChars;
+		Text m_plain;
+		Machine m_key;
+		Session m_session; // m_plain under m_key, unless m_stale
+		bool m_stale{ false };
+	};
+
+	typedef BasicCipherEditor<EnigmaMachine> CipherEditor;
+}
@@ -0,0 +1,279 @@
+// EnigmaEngines.h - Alternative encryption engines equivalent to EnigmaMachine (C++14)
+//
+// Both engines take their key from a configured EnigmaMachine and must produce exactly what
+// EnigmaMachine::encrypt/encryptIndex would, stepping included. M4 machines are accepted as well: their Greek
+// wheel never steps, so it arrives already folded into the machine's turnaround table and costs nothing here.
+//
+// TableEngine (one key, long stream). Rotor offsets o = position - ring are tracked instead of positions, so
+// a rotor is at its notch when bit o of its notch mask is set. Setup builds, for every right-rotor offset, the
+// right rotor's forward/backward permutation with the plugboard folded in (26x26 bytes each). The middle
+// rotor, left rotor and reflector only change when the middle rotor steps, so their composition (the "inner"
+// permutation) is rebuilt from pre-rotated middle/left tables then, about once per 26 letters. A letter costs
+// three byte lookups.
+//
+// BatchEngineAvx2 (many keys, same text). Eight keys run in the lanes of AVX2 registers. Each lane has its own
+// 4 KB table block (pre-rotated forward/backward tables for all three rotors, plugboard folded into the right
+// rotor, reflector); a letter is seven gathers plus vector stepping. Compiled for x86 only and must only be
+// called when QueryCpuFeatures().avx2 is set (see EnigmaDispatch.h).
+
+#pragma once
+
+#include "Enigma.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#define ENIGMA_HAVE_AVX2_ENGINE 1
+#define ENIGMA_TARGET_AVX2
+#define ENIGMA_TARGET_AVX2_LAMBDA
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ENIGMA_HAVE_AVX2_ENGINE 1
+#define ENIGMA_TARGET_AVX2 __attribute__((target("avx2")))
+#define ENIGMA_TARGET_AVX2_LAMBDA __attribute__((target("avx2")))
+#endif
+
+namespace EnigmaCore
+{
+	namespace EngineDetail
+	{
+		// fwd[o*26 + i] / bwd[o*26 + i]: the rotor's forward/backward map at offset o, copied from the rotor's
+		// shared compiled wiring.
+		inline void RotatedTables(const Rotor& rotor, uint8_t* fwd, uint8_t* bwd)
+		{
+			std::memcpy(fwd, rotor.wiring().rotFwd, 676);
+			std::memcpy(bwd, rotor.wiring().rotRev, 676);
+		}
+
+		// Right rotor tables with the plugboard and entry wheel folded in: plug -> entry -> rotor forward, rotor
+		// backward -> entry -> plug.
+		template <class Machine>
+		void RightTables(const Machine& em, uint8_t* fwd, uint8_t* bwd)
+		{
+			const uint8_t* f = em.rightRotor().wiring().rotFwd;
+			const uint8_t* b = em.rightRotor().wiring().rotRev;
+			uint8_t in[26], out[26];
+			for (int i = 0; i < 26; ++i)
+			{
+				in[i] = (uint8_t)em.entryIn(i);
+				out[i] = (uint8_t)em.entryOut(i);
+			}
+			for (int o = 0; o < 26; ++o)
+			{
+				for (int i = 0; i < 26; ++i)
+				{
+					fwd[o * 26 + i] = f[o * 26 + in[i]];
+					bwd[o * 26 + i] = out[b[o * 26 + i]];
+				}
+			}
+		}
+	}
+
+	class TableEngine
+	{
+	public:
+		TableEngine() = default;
+
+		template <int N, class Probe>
+		explicit TableEngine(const BasicEnigmaMachineN<N, Probe>& em) { load(em); }
+
+		// Take the key and current positions from a machine.
+		template <int N, class Probe>
+		void load(const BasicEnigmaMachineN<N, Probe>& em)
+		{
+			const Rotor* rotors[3] = { &em.leftRotor(), &em.middleRotor(), &em.rightRotor() };
+			for (int i = 0; i < 3; ++i)
+			{
+				m_ring[i] = rotors[i]->ring();
+				m_offset[i] = rotors[i]->offset();
+				m_notchMask[i] = rotors[i]->notchMask();
+			}
+			for (int i = 0; i < 26; ++i) m_reflector[i] = (uint8_t)em.turnaround(i);
+			EngineDetail::RotatedTables(em.leftRotor(), m_leftFwd, m_leftBwd);
+			EngineDetail::RotatedTables(em.middleRotor(), m_midFwd, m_midBwd);
+			EngineDetail::RightTables(em, &m_rightFwd[0][0], &m_rightBwd[0][0]);
+			rebuildInner();
+		}
+
+		// Write the current positions back, so the machine continues where the engine stopped.
+		template <int N, class Probe>
+		void store(BasicEnigmaMachineN<N, Probe>& em) const
+		{
+			em.setPositions(leftPos(), midPos(), rightPos());
+		}
+
+		int leftPos() const { return mod26(m_offset[0] + m_ring[0]); }
+		int midPos() const { return mod26(m_offset[1] + m_ring[1]); }
+		int rightPos() const { return mod26(m_offset[2] + m_ring[2]); }
+
+		int encryptIndex(int x)
+		{
+			step();
+			const int o = m_offset[2];
+			return m_rightBwd[o][m_inner[m_rightFwd[o][x]]];
+		}
+
+		void encryptIndices(const uint8_t* in, uint8_t* out, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i) out[i] = (uint8_t)encryptIndex(in[i]);
+		}
+
+		// Same contract as EnigmaMachine::encrypt: letters are encrypted (as uppercase), everything else is copied.
+		std::string encrypt(const std::string& s)
+		{
+			std::string out(s);
+			for (char& c : out)
+			{
+				int i = ch2i(c);
+				if (i != -1) c = (char)('A' + encryptIndex(i));
+			}
+			return out;
+		}
+
+	private:
+		static int inc(int o) { return o == 25 ? 0 : o + 1; }
+
+		void step()
+		{
+			const bool rightAtNotch = (m_notchMask[2] >> m_offset[2]) & 1;
+			const bool middleAtNotch = (m_notchMask[1] >> m_offset[1]) & 1;
+			if (rightAtNotch || middleAtNotch)
+			{
+				m_offset[1] = inc(m_offset[1]);
+				if (middleAtNotch) m_offset[0] = inc(m_offset[0]);
+				rebuildInner();
+			}
+			m_offset[2] = inc(m_offset[2]);
+		}
+
+		// Middle rotor -> left rotor -> reflector -> left rotor -> middle rotor at the current offsets.
+		void rebuildInner()
+		{
+			const uint8_t* lf = m_leftFwd + m_offset[0] * 26;
+			const uint8_t* lb = m_leftBwd + m_offset[0] * 26;
+			const uint8_t* mf = m_midFwd + m_offset[1] * 26;
+			const uint8_t* mb = m_midBwd + m_offset[1] * 26;
+			for (int i = 0; i < 26; ++i) m_inner[i] = mb[lb[m_reflector[lf[mf[i]]]]];
+		}
+
+		int m_ring[3]{};
+		int m_offset[3]{}; // left, middle, right
+		uint32_t m_notchMask[3]{};
+		uint8_t m_rightFwd[26][26]{}; // [offset][letter], plugboard folded in
+		uint8_t m_rightBwd[26][26]{};
+		uint8_t m_leftFwd[676]{}, m_leftBwd[676]{}; // [offset*26 + letter]
+		uint8_t m_midFwd[676]{}, m_midBwd[676]{};
+		uint8_t m_reflector[26]{};
+		uint8_t m_inner[26]{};
+	};
+
+#if defined(ENIGMA_HAVE_AVX2_ENGINE)
+	class BatchEngineAvx2
+	{
+	public:
+		static const int kLanes = 8;
+
+		// Encrypt the same letter text (indices 0..25) under n keys: out[k*len + i] is letter i under machines[k].
+		// The machines are not advanced.
+		template <int N, class Probe>
+		static void encryptManyKeys(const BasicEnigmaMachineN<N, Probe>* machines, size_t n, const uint8_t* text, size_t len, uint8_t* out)
+		{
+			BatchEngineAvx2 engine;
+			for (size_t k = 0; k < n; k += kLanes)
+			{
+				int lanes = (int)((n - k) < (size_t)kLanes ? (n - k) : (size_t)kLanes);
+				for (int l = 0; l < kLanes; ++l) engine.loadLane(l, machines[k + (l < lanes ? l : 0)]);
+				engine.run(text, len, out + k * len, lanes);
+			}
+		}
+
+	private:
+		// Per-lane block layout (bytes). Gathers read 4 bytes, so every block ends with padding.
+		enum { kRightFwd = 0, kRightBwd = 676, kMidFwd = 1352, kMidBwd = 2028, kLeftFwd = 2704, kLeftBwd = 3380,
+			kReflector = 4056, kBlockSize = 4096 };
+
+		BatchEngineAvx2() : m_tables((size_t)kLanes * kBlockSize, 0) {}
+
+		template <int N, class Probe>
+		void loadLane(int lane, const BasicEnigmaMachineN<N, Probe>& em)
+		{
+			uint8_t* b = &m_tables[(size_t)lane * kBlockSize];
+			EngineDetail::RightTables(em, b + kRightFwd, b + kRightBwd);
+			EngineDetail::RotatedTables(em.middleRotor(), b + kMidFwd, b + kMidBwd);
+			EngineDetail::RotatedTables(em.leftRotor(), b + kLeftFwd, b + kLeftBwd);
+			for (int i = 0; i < 26; ++i) b[kReflector + i] = (uint8_t)em.turnaround(i);
+
+			m_offset[0][lane] = em.leftRotor().offset();
+			m_offset[1][lane] = em.middleRotor().offset();
+			m_offset[2][lane] = em.rightRotor().offset();
+			m_notchMask[1][lane] = (int32_t)em.middleRotor().notchMask();
+			m_notchMask[2][lane] = (int32_t)em.rightRotor().notchMask();
+		}
+
+		ENIGMA_TARGET_AVX2 void run(const uint8_t* text, size_t len, uint8_t* out, int lanes)
+		{
+			const __m256i one = _mm256_set1_epi32(1);
+			const __m256i n25 = _mm256_set1_epi32(25);
+			const __m256i wrap = _mm256_set1_epi32(-25);
+			const __m256i all = _mm256_set1_epi32(-1);
+			const __m256i byteMask = _mm256_set1_epi32(0xff);
+			const __m256i laneBase = _mm256_setr_epi32(0, kBlockSize, 2 * kBlockSize, 3 * kBlockSize,
+				4 * kBlockSize, 5 * kBlockSize, 6 * kBlockSize, 7 * kBlockSize);
+			const __m256i notchM = _mm256_loadu_si256((const __m256i*)m_notchMask[1]);
+			const __m256i notchR = _mm256_loadu_si256((const __m256i*)m_notchMask[2]);
+			__m256i oL = _mm256_loadu_si256((const __m256i*)m_offset[0]);
+			__m256i oM = _mm256_loadu_si256((const __m256i*)m_offset[1]);
+			__m256i oR = _mm256_loadu_si256((const __m256i*)m_offset[2]);
+			const uint8_t* t = m_tables.data();
+			alignas(32) int32_t res[kLanes];
+
+			// o + 1 mod 26 in the lanes where `mask` is set
+			auto step = [&](const __m256i& o, const __m256i& mask) ENIGMA_TARGET_AVX2_LAMBDA
+			{
+				return _mm256_add_epi32(o, _mm256_and_si256(mask, _mm256_blendv_epi8(one, wrap, _mm256_cmpeq_epi32(o, n25))));
+			};
+			// Start of the lane's row for offset o: lane block + o*26.
+			auto row = [&](const __m256i& o) ENIGMA_TARGET_AVX2_LAMBDA
+			{
+				__m256i o2 = _mm256_slli_epi32(o, 1);
+				return _mm256_add_epi32(laneBase, _mm256_add_epi32(_mm256_add_epi32(o2, _mm256_slli_epi32(o2, 2)), _mm256_slli_epi32(o2, 3)));
+			};
+			// Byte at table + index in each lane (gathers load 4 bytes; blocks are padded).
+			auto lookup = [&](int table, const __m256i& index) ENIGMA_TARGET_AVX2_LAMBDA
+			{
+				return _mm256_and_si256(byteMask, _mm256_i32gather_epi32((const int*)(t + table), index, 1));
+			};
+
+			for (size_t i = 0; i < len; ++i)
+			{
+				const __m256i rightAtNotch = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srlv_epi32(notchR, oR), one), one);
+				const __m256i middleAtNotch = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srlv_epi32(notchM, oM), one), one);
+				oL = step(oL, middleAtNotch);
+				oM = step(oM, _mm256_or_si256(rightAtNotch, middleAtNotch));
+				oR = step(oR, all);
+				const __m256i rowL = row(oL), rowM = row(oM), rowR = row(oR);
+
+				__m256i x = _mm256_set1_epi32(text[i]);
+				x = lookup(kRightFwd, _mm256_add_epi32(rowR, x));
+				x = lookup(kMidFwd, _mm256_add_epi32(rowM, x));
+				x = lookup(kLeftFwd, _mm256_add_epi32(rowL, x));
+				x = lookup(kReflector, _mm256_add_epi32(laneBase, x));
+				x = lookup(kLeftBwd, _mm256_add_epi32(rowL, x));
+				x = lookup(kMidBwd, _mm256_add_epi32(rowM, x));
+				x = lookup(kRightBwd, _mm256_add_epi32(rowR, x));
+
+				_mm256_store_si256((__m256i*)res, x);
+				for (int l = 0; l < lanes; ++l) out[(size_t)l * len + i] = (uint8_t)res[l];
+			}
+		}
+
+		std::vector<uint8_t> m_tables;
+		int32_t m_offset[3][kLanes]{};
+		int32_t m_notchMask[3][kLanes]{};
+	};
+#endif
+}
@@ -0,0 +1,379 @@
+// EnigmaKeysheet.h - Keysheet (daily key) database with bulk parsing and indexed lookup (C++14)
+//
+// File format: one daily key per line, whitespace separated, '#' starts a comment.
+//
+//   # date     net    ukw  rotors        rings  grund  plugboard
+//   1942-05-17 WOTAN  B    IV-II-V       GMY    DKP    AV BS CG DL FU HZ IN KM OW RX
+//   1943-03-09 TRITON B    Beta-II-IV-I  AAAV   VVJA
+//
+// - date: YYYY-MM-DD
+// - net: identifier of the key net (any token without whitespace, up to 15 characters)
+// - ukw: reflector letter (B or C); the thin B or C on an M4 line
+// - rotors: left-middle-right in Roman numerals (I-VIII); an M4 line starts with the Greek wheel, Beta or Gamma
+// - rings / grund: three letters each (left, middle, right), four on an M4 line (Greek wheel first)
+// - plugboard: any number of letter pairs (may be empty)
+//
+// Loading scans the file buffer with pointers only (no std::string/stream per line) and produces compact
+// KeyRecord entries. Lookups go through an index on (date, net id); resolve the net name to its id once with
+// netId() and every further lookup is a single hash probe. BuildMachine() configures an EnigmaMachine straight
+// from a three-rotor record without any string parsing, BuildMachineM4() an EnigmaMachineM4 from an M4 record.
+
+#pragma once
+
+#include "Enigma.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace EnigmaCore
+{
+	// Compact daily key: indices as used by RotorByIndex/ReflectorByIndex, letters as 0..25.
+	struct KeyRecord
+	{
+		uint32_t date{ 0 }; // yyyymmdd
+		uint32_t net{ 0 }; // id from Keysheet::netId()
+		uint8_t reflector{ 0 };
+		uint8_t rotors[3]{}; // left, middle, right
+		uint8_t rings[3]{};
+		uint8_t positions[3]{};
+		uint8_t plug[26]{}; // plugboard permutation (identity when unplugged)
+		uint8_t greek{ 0 }; // M4 Greek wheel: rotor index 8 (Beta) or 9 (Gamma); 0 for a three-rotor key
+		uint8_t greekRing{ 0 };
+		uint8_t greekPosition{ 0 };
+	};
+
+	namespace KeysheetDetail
+	{
+		template <class Machine>
+		void Configure(const KeyRecord& k, Machine& em)
+		{
+			Rotor r[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				r[i] = RotorByIndex(k.rotors[i]);
+				r[i].setRing(k.rings[i]);
+				r[i].setPosition(k.positions[i]);
+			}
+			Plugboard plug;
+			for (int i = 0; i < 26; ++i)
+			{
+				if (k.plug[i] > i) plug.connect(i, k.plug[i]);
+			}
+			em.setReflector(ReflectorByIndex(k.reflector));
+			em.setRotors(r[0], r[1], r[2]);
+			em.setPlugboard(plug);
+		}
+	}
+
+	// Configure a machine from a three-rotor key record (greek == 0).
+	inline EnigmaMachine BuildMachine(const KeyRecord& k)
+	{
+		EnigmaMachine em;
+		KeysheetDetail::Configure(k, em);
+		return em;
+	}
+
+	// Configure an M4 from a key record with a Greek wheel.
+	inline EnigmaMachineM4 BuildMachineM4(const KeyRecord& k)
+	{
+		EnigmaMachineM4 em;
+		KeysheetDetail::Configure(k, em);
+		Rotor greek = RotorByIndex(k.greek);
+		greek.setRing(k.greekRing);
+		greek.setPosition(k.greekPosition);
+		em.setRotor(0, greek);
+		return em;
+	}
+
+	class Keysheet
+	{
+	public:
+		struct LoadResult
+		{
+			size_t loaded{ 0 };
+			size_t rejected{ 0 };
+			size_t firstBadLine{ 0 }; // 1-based, 0 if every line parsed
+		};
+
+		// Parse a whole buffer (e.g. a mapped file). Records are appended; a later key for the same
+		// (date, net) replaces the earlier one in the index.
+		LoadResult parse(const char* begin, const char* end)
+		{
+			LoadResult res;
+			size_t lineNo = 0;
+			const char* p = begin;
+			while (p < end)
+			{
+				const char* eol = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+				if (!eol) eol = end;
+				++lineNo;
+				KeyRecord rec;
+				int r = parseLine(p, eol, rec);
+				if (r > 0)
+				{
+					add(rec);
+					++res.loaded;
+				}
+				else if (r < 0)
+				{
+					++res.rejected;
+					if (!res.firstBadLine) res.firstBadLine = lineNo;
+				}
+				p = (eol == end) ? end : eol + 1; // no pointer past the end when the last line has no newline
+			}
+			return res;
+		}
+
+		// Load a keysheet file. The file is memory-mapped where available and read in one go otherwise.
+		bool loadFile(const std::string& path, LoadResult* result = nullptr)
+		{
+			LoadResult res;
+#if !defined(_WIN32)
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) return false;
+			struct stat st;
+			if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+			if (st.st_size > 0)
+			{
+				void* base = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (base == MAP_FAILED) { ::close(fd); return false; }
+				::madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+				const char* b = static_cast<const char*>(base);
+				res = parse(b, b + st.st_size);
+				::munmap(base, (size_t)st.st_size);
+			}
+			::close(fd);
+#else
+			std::ifstream f(path, std::ios::binary);
+			if (!f) return false;
+			f.seekg(0, std::ios::end);
+			std::streamoff n = f.tellg();
+			f.seekg(0, std::ios::beg);
+			std::vector<char> buf((size_t)(n > 0 ? n : 0));
+			if (!buf.empty() && !f.read(buf.data(), (std::streamsize)buf.size())) return false;
+			res = parse(buf.data(), buf.data() + buf.size());
+#endif
+			if (result) *result = res;
+			return true;
+		}
+
+		// Id for a net name, allocating one if the net is new. Resolve once, then use find() in hot loops.
+		uint32_t netId(const std::string& name)
+		{
+			auto it = m_netIds.find(name);
+			if (it != m_netIds.end()) return it->second;
+			uint32_t id = (uint32_t)m_netNames.size();
+			m_netIds.emplace(name, id);
+			m_netNames.push_back(name);
+			return id;
+		}
+
+		// Returns -1 if the net is unknown.
+		int64_t findNet(const std::string& name) const
+		{
+			auto it = m_netIds.find(name);
+			return (it == m_netIds.end()) ? -1 : (int64_t)it->second;
+		}
+
+		const std::string& netName(uint32_t id) const { return m_netNames[id]; }
+
+		// O(1) lookup by (date, net id). Returns nullptr if there is no key for that day.
+		const KeyRecord* find(uint32_t date, uint32_t net) const
+		{
+			auto it = m_index.find(indexKey(date, net));
+			return (it == m_index.end()) ? nullptr : &m_records[it->second];
+		}
+
+		void add(const KeyRecord& rec)
+		{
+			m_index[indexKey(rec.date, rec.net)] = (uint32_t)m_records.size();
+			m_records.push_back(rec);
+		}
+
+		size_t size() const { return m_records.size(); }
+		const std::vector<KeyRecord>& records() const { return m_records; }
+
+		void clear()
+		{
+			m_records.clear();
+			m_index.clear();
+			m_netIds.clear();
+			m_netNames.clear();
+			m_lastNet = -1;
+		}
+
+		// yyyymmdd from "YYYY-MM-DD"; 0 if malformed.
+		static uint32_t parseDate(const char* p, const char* end)
+		{
+			if (end - p != 10 || p[4] != '-' || p[7] != '-') return 0;
+			uint32_t y = 0, m = 0, d = 0;
+			if (!digits(p, 4, y) || !digits(p + 5, 2, m) || !digits(p + 8, 2, d)) return 0;
+			if (m < 1 || m > 12 || d < 1 || d > daysInMonth(y, m)) return 0;
+			return y * 10000 + m * 100 + d;
+		}
+
+		static uint32_t daysInMonth(uint32_t y, uint32_t m)
+		{
+			static const uint8_t days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+			const bool leap = y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+			return days[m - 1] + (m == 2 && leap ? 1 : 0);
+		}
+
+		// Greek wheel name to rotor index (Beta = 8, Gamma = 9); -1 if unknown.
+		static int parseGreek(const char* p, const char* end)
+		{
+			const size_t n = (size_t)(end - p);
+			if (n == 4 && std::memcmp(p, "Beta", 4) == 0) return 8;
+			if (n == 5 && std::memcmp(p, "Gamma", 5) == 0) return 9;
+			return -1;
+		}
+
+		// Roman numeral rotor name to rotor index (I = 0); -1 if unknown.
+		static int parseRotor(const char* p, const char* end)
+		{
+			static const char* const names[] = { "I", "II", "III", "IV", "V", "VI", "VII", "VIII" };
+			size_t n = (size_t)(end - p);
+			for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); ++i)
+			{
+				if (std::strlen(names[i]) == n && std::memcmp(names[i], p, n) == 0) return i;
+			}
+			return -1;
+		}
+
+	private:
+		static uint64_t indexKey(uint32_t date, uint32_t net) { return ((uint64_t)date << 32) | net; }
+
+		static bool digits(const char* p, int n, uint32_t& out)
+		{
+			out = 0;
+			for (int i = 0; i < n; ++i)
+			{
+				if (p[i] < '0' || p[i] > '9') return false;
+				out = out * 10 + (uint32_t)(p[i] - '0');
+			}
+			return true;
+		}
+
+		static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+		// Next whitespace-delimited token in [p, end); false at end of line.
+		static bool token(const char*& p, const char* end, const char*& tb, const char*& te)
+		{
+			while (p < end && isSpace(*p)) ++p;
+			if (p >= end || *p == '#') return false;
+			tb = p;
+			while (p < end && !isSpace(*p)) ++p;
+			te = p;
+			return true;
+		}
+
+		static bool letters3(const char* tb, const char* te, uint8_t out[3])
+		{
+			if (te - tb != 3) return false;
+			for (int i = 0; i < 3; ++i)
+			{
+				int v = ch2i(tb[i]);
+				if (v < 0) return false;
+				out[i] = (uint8_t)v;
+			}
+			return true;
+		}
+
+		// Rings or grund: three letters, after the Greek wheel's letter on an M4 line.
+		static bool rotorLetters(const char* tb, const char* te, bool m4, uint8_t& greek, uint8_t out[3])
+		{
+			if (m4)
+			{
+				if (te - tb != 4 || ch2i(*tb) < 0) return false;
+				greek = (uint8_t)ch2i(*tb++);
+			}
+			return letters3(tb, te, out);
+		}
+
+		// 1 = record parsed, 0 = blank/comment line, -1 = malformed
+		int parseLine(const char* p, const char* end, KeyRecord& rec)
+		{
+			const char *tb, *te;
+			if (!token(p, end, tb, te)) return 0;
+			rec.date = parseDate(tb, te);
+			if (!rec.date) return -1;
+
+			const char *netBegin, *netEnd;
+			if (!token(p, end, netBegin, netEnd) || netEnd - netBegin > 15) return -1;
+
+			if (!token(p, end, tb, te) || te - tb != 1) return -1;
+			if (*tb == 'B' || *tb == 'b') rec.reflector = 0;
+			else if (*tb == 'C' || *tb == 'c') rec.reflector = 1;
+			else return -1;
+
+			if (!token(p, end, tb, te)) return -1;
+			const char* first = tb;
+			while (first < te && *first != '-') ++first;
+			const int greek = parseGreek(tb, first);
+			if (greek >= 0)
+			{
+				if (first == te) return -1;
+				rec.greek = (uint8_t)greek;
+				rec.reflector += 2; // thin B/C
+				tb = first + 1;
+			}
+			const bool m4 = greek >= 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				const char* dash = tb;
+				while (dash < te && *dash != '-') ++dash;
+				if ((i < 2) != (dash < te)) return -1;
+				int r = parseRotor(tb, dash);
+				if (r < 0) return -1;
+				rec.rotors[i] = (uint8_t)r;
+				tb = dash + 1;
+			}
+
+			if (!token(p, end, tb, te) || !rotorLetters(tb, te, m4, rec.greekRing, rec.rings)) return -1;
+			if (!token(p, end, tb, te) || !rotorLetters(tb, te, m4, rec.greekPosition, rec.positions)) return -1;
+
+			for (int i = 0; i < 26; ++i) rec.plug[i] = (uint8_t)i;
+			while (token(p, end, tb, te))
+			{
+				if (te - tb != 2) return -1;
+				int a = ch2i(tb[0]), b = ch2i(tb[1]);
+				if (a < 0 || b < 0 || a == b || rec.plug[a] != a || rec.plug[b] != b) return -1;
+				rec.plug[a] = (uint8_t)b;
+				rec.plug[b] = (uint8_t)a;
+			}
+			rec.net = netIdFor(netBegin, netEnd); // only now: a rejected line must not leave a net behind
+			return 1;
+		}
+
+		uint32_t netIdFor(const char* tb, const char* te)
+		{
+			// Most sheets repeat the same few nets; avoid building a string when the last one matches.
+			size_t n = (size_t)(te - tb);
+			if (m_lastNet >= 0)
+			{
+				const std::string& last = m_netNames[(size_t)m_lastNet];
+				if (last.size() == n && std::memcmp(last.data(), tb, n) == 0) return (uint32_t)m_lastNet;
+			}
+			uint32_t id = netId(std::string(tb, n));
+			m_lastNet = (int64_t)id;
+			return id;
+		}
+
+		std::vector<KeyRecord> m_records;
+		std::unordered_map<uint64_t, uint32_t> m_index;
+		std::unordered_map<std::string, uint32_t> m_netIds;
+		std::vector<std::string> m_netNames;
+		int64_t m_lastNet{ -1 };
+	};
+}
@@ -0,0 +1,126 @@
+// EnigmaMachineCache.h - Ready-to-run machines by key, shared across the process (C++14)
+//
+// The components themselves cost nothing to look up: the built-in wirings are compile-time tables shared by
+// every copy (Enigma.h). What remains per key is assembling a machine: rotors with rings and positions, the
+// reflector, and the plugboard composed into the machine's entry and exit tables. A MachineCache does that once
+// per distinct key and afterwards hands out copies, for a hash of the state and a copy of the machine.
+//
+// The cache key is the whole MachineState (reflector, rotor order, rings, start positions, plugboard). It holds
+// three-rotor machines, so M4 states are refused like invalid ones. Entries are evicted least recently used
+// first once the capacity is reached. One mutex guards the map and is held for the lookup and the copy, so one
+// cache may serve any number of threads. SharedMachineCache() is the instance for the whole process. A component
+// that serves one workload (the daemon) may keep its own.
+
+#pragma once
+
+#include "Enigma.h"
+#include "EnigmaState.h"
+
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace EnigmaCore
+{
+	class MachineCache
+	{
+	public:
+		static const size_t kDefaultCapacity = 4096;
+
+		explicit MachineCache(size_t capacity = kDefaultCapacity) : m_capacity(capacity ? capacity : 1) {}
+
+		MachineCache(const MachineCache&) = delete;
+		MachineCache& operator=(const MachineCache&) = delete;
+
+		// The machine for `key` at its start position. Returns false, leaving `out` alone, if the state is invalid
+		// or an M4 state.
+		bool get(const MachineState& key, EnigmaMachine& out)
+		{
+			if (!IsValidState(key) || IsM4State(key)) return false;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_entries.find(key);
+			if (it != m_entries.end())
+			{
+				++m_hits;
+				m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+				out = it->second.machine;
+				return true;
+			}
+			++m_misses;
+			if (m_entries.size() >= m_capacity)
+			{
+				m_entries.erase(m_lru.back());
+				m_lru.pop_back();
+			}
+			m_lru.push_front(key);
+			Entry& e = m_entries[key];
+			e.lru = m_lru.begin();
+			e.machine = LoadState(key);
+			out = e.machine;
+			return true;
+		}
+
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_entries.clear();
+			m_lru.clear();
+		}
+
+		size_t size() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_entries.size();
+		}
+		uint64_t hits() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_hits;
+		}
+		uint64_t misses() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_misses;
+		}
+
+	private:
+		static_assert(sizeof(MachineState) == 39, "MachineState is hashed and compared as bytes");
+
+		struct KeyHash
+		{
+			// Eight bytes at a time: a byte-wise hash of the 39 bytes would cost more than the rest of a lookup
+			size_t operator()(const MachineState& s) const
+			{
+				uint64_t w[5] = {};
+				std::memcpy(w, &s, sizeof(s));
+				uint64_t h = 0;
+				for (uint64_t x : w) h = (h ^ x) * 0x9E3779B97F4A7C15ull;
+				return (size_t)(h ^ (h >> 29));
+			}
+		};
+		struct KeyEqual
+		{
+			bool operator()(const MachineState& a, const MachineState& b) const { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+		};
+		struct Entry
+		{
+			EnigmaMachine machine;
+			std::list<MachineState>::iterator lru;
+		};
+
+		const size_t m_capacity;
+		mutable std::mutex m_mutex;
+		std::unordered_map<MachineState, Entry, KeyHash, KeyEqual> m_entries;
+		std::list<MachineState> m_lru; // most recently used first
+		uint64_t m_hits{ 0 }, m_misses{ 0 };
+	};
+
+	// The process-wide cache, created on first use.
+	inline MachineCache& SharedMachineCache()
+	{
+		static MachineCache cache;
+		return cache;
+	}
+}
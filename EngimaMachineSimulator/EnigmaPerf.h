@@ -0,0 +1,175 @@
+// EnigmaPerf.h - Hardware performance counters around encrypt/search kernels (Linux perf_event_open, C++14)
+//
+// PerfCounters opens one counter per event for the calling thread (user space only, so it works at
+// perf_event_paranoid <= 2):
+//   cycles, instructions, L1D read misses, last-level-cache read misses, branch mispredicts.
+// With inheritToNewThreads the counters also follow threads created *after* construction, so build the
+// PerfCounters before a WorkStealingScheduler to include its pool. Reading a counter sums the live inherited
+// children as well.
+//
+//   PerfCounters perf;
+//   perf.start();
+//   ... kernel over N letters/keys ...
+//   PerfReading r = perf.stop();
+//   std::string json = r.toJson(N); // totals and per-op figures
+//
+// Events are opened independently, so one that the CPU or hypervisor does not expose is reported as null and
+// the others still count. If the kernel multiplexes counters, values are scaled by enabled/running time.
+// On other platforms (and when perf_event_open is denied) available() is false and readings are all null.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace EnigmaCore
+{
+	enum PerfEvent { kPerfCycles, kPerfInstructions, kPerfL1dMisses, kPerfLlcMisses, kPerfBranchMisses, kPerfEventCount };
+
+	inline const char* PerfEventName(PerfEvent e)
+	{
+		static const char* const names[kPerfEventCount] = { "cycles", "instructions", "l1dMisses", "llcMisses", "branchMisses" };
+		return (e >= 0 && e < kPerfEventCount) ? names[e] : "?";
+	}
+
+	struct PerfReading
+	{
+		bool valid[kPerfEventCount]{};
+		double value[kPerfEventCount]{}; // scaled for multiplexing
+
+		// {"cycles":..,"cyclesPerOp":..,...,"ipc":..}; unavailable events are null.
+		std::string toJson(uint64_t ops) const
+		{
+			char buf[96];
+			std::string out = "{";
+			for (int i = 0; i < kPerfEventCount; ++i)
+			{
+				const char* name = PerfEventName((PerfEvent)i);
+				if (valid[i])
+					std::snprintf(buf, sizeof(buf), "%s\"%s\":%.0f,\"%sPerOp\":%.4g", i ? "," : "", name, value[i], name, ops ? value[i] / (double)ops : 0.0);
+				else
+					std::snprintf(buf, sizeof(buf), "%s\"%s\":null,\"%sPerOp\":null", i ? "," : "", name, name);
+				out += buf;
+			}
+			if (valid[kPerfCycles] && valid[kPerfInstructions] && value[kPerfCycles] > 0.0)
+				std::snprintf(buf, sizeof(buf), ",\"ipc\":%.3f}", value[kPerfInstructions] / value[kPerfCycles]);
+			else
+				std::snprintf(buf, sizeof(buf), ",\"ipc\":null}");
+			out += buf;
+			return out;
+		}
+	};
+
+	class PerfCounters
+	{
+	public:
+		explicit PerfCounters(bool inheritToNewThreads = true)
+		{
+			for (int i = 0; i < kPerfEventCount; ++i) m_fd[i] = -1;
+#if defined(__linux__)
+			static const uint32_t types[kPerfEventCount] = {
+				PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+			static const uint64_t configs[kPerfEventCount] = {
+				PERF_COUNT_HW_CPU_CYCLES,
+				PERF_COUNT_HW_INSTRUCTIONS,
+				PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+				PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+				PERF_COUNT_HW_BRANCH_MISSES };
+			int lastErrno = 0;
+			for (int i = 0; i < kPerfEventCount; ++i)
+			{
+				struct perf_event_attr attr;
+				std::memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = types[i];
+				attr.config = configs[i];
+				attr.disabled = 1;
+				attr.inherit = inheritToNewThreads ? 1 : 0;
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				m_fd[i] = (int)::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+				if (m_fd[i] < 0) lastErrno = errno;
+			}
+			if (!available())
+			{
+				m_error = std::string("perf_event_open failed: ") + std::strerror(lastErrno);
+				if (lastErrno == EACCES || lastErrno == EPERM) m_error += " (check /proc/sys/kernel/perf_event_paranoid)";
+			}
+#else
+			(void)inheritToNewThreads;
+			m_error = "hardware counters need Linux perf_event_open";
+#endif
+		}
+
+		~PerfCounters()
+		{
+#if defined(__linux__)
+			for (int fd : m_fd)
+			{
+				if (fd >= 0) ::close(fd);
+			}
+#endif
+		}
+
+		PerfCounters(const PerfCounters&) = delete;
+		PerfCounters& operator=(const PerfCounters&) = delete;
+
+		bool available() const
+		{
+			for (int fd : m_fd)
+			{
+				if (fd >= 0) return true;
+			}
+			return false;
+		}
+
+		// Why nothing could be opened (empty if available()).
+		const std::string& error() const { return m_error; }
+
+		void start()
+		{
+#if defined(__linux__)
+			for (int fd : m_fd)
+			{
+				if (fd < 0) continue;
+				::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+#endif
+		}
+
+		PerfReading stop()
+		{
+			PerfReading r;
+#if defined(__linux__)
+			for (int fd : m_fd)
+			{
+				if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			}
+			for (int i = 0; i < kPerfEventCount; ++i)
+			{
+				uint64_t v[3]; // value, time enabled, time running
+				if (m_fd[i] < 0 || ::read(m_fd[i], v, sizeof(v)) != (ssize_t)sizeof(v) || v[2] == 0) continue;
+				r.valid[i] = true;
+				r.value[i] = (double)v[0] * ((double)v[1] / (double)v[2]);
+			}
+#endif
+			return r;
+		}
+
+	private:
+		int m_fd[kPerfEventCount];
+		std::string m_error;
+	};
+}
@@ -0,0 +1,131 @@
+// EnigmaProbe.h - Hot-path instrumentation probes for BasicEnigmaMachine (C++14)
+//
+// BasicEnigmaMachine<Probe> calls three hooks per letter: letterBegin(), stageDone(stage) after each stage of
+// encryptIndex, and stepped(rightTurnover, middleTurnover) from stepRotors. The default NullProbe (Enigma.h)
+// makes them all empty, so EnigmaMachine is unchanged. For production profiling use
+//
+//   BasicEnigmaMachine<CountingProbe> em;  // letters and stepping events only (a few adds per letter)
+//   BasicEnigmaMachine<TimingProbe> em;    // plus cycle counter deltas per stage
+//   ... em.encrypt(text) ...
+//   std::string json = CountersToJson(em.probe().counters());
+//
+// Stage cycles come from the TSC where available (rdtsc costs ~20 cycles per read, so absolute numbers
+// include the measurement itself; use them to compare stages) and from steady_clock nanoseconds otherwise.
+
+#pragma once
+
+#include "Enigma.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ENIGMA_HAVE_RDTSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define ENIGMA_HAVE_RDTSC 1
+#endif
+
+namespace EnigmaCore
+{
+	inline uint64_t ReadCycleCounter()
+	{
+#if defined(ENIGMA_HAVE_RDTSC)
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	struct EngineCounters
+	{
+		uint64_t letters{ 0 };
+		uint64_t rightTurnovers{ 0 }; // right rotor at notch: carries into the middle rotor
+		uint64_t middleTurnovers{ 0 }; // middle rotor at notch: carries into the left rotor
+		uint64_t doubleSteps{ 0 }; // middle rotor stepped by its own notch (right not at notch)
+		uint64_t stageCycles[kStageCount]{};
+
+		void reset() { *this = EngineCounters(); }
+
+		void add(const EngineCounters& o)
+		{
+			letters += o.letters;
+			rightTurnovers += o.rightTurnovers;
+			middleTurnovers += o.middleTurnovers;
+			doubleSteps += o.doubleSteps;
+			for (int i = 0; i < kStageCount; ++i) stageCycles[i] += o.stageCycles[i];
+		}
+	};
+
+	inline const char* StageName(EnigmaStage s)
+	{
+		static const char* const names[kStageCount] = { "step", "plugIn", "rotorsForward", "reflector", "rotorsBackward", "plugOut" };
+		return (s >= 0 && s < kStageCount) ? names[s] : "?";
+	}
+
+	inline std::string CountersToJson(const EngineCounters& c)
+	{
+		char buf[128];
+		std::string out = "{";
+		std::snprintf(buf, sizeof(buf), "\"letters\":%llu,\"rightTurnovers\":%llu,\"middleTurnovers\":%llu,\"doubleSteps\":%llu,",
+			(unsigned long long)c.letters, (unsigned long long)c.rightTurnovers,
+			(unsigned long long)c.middleTurnovers, (unsigned long long)c.doubleSteps);
+		out += buf;
+		out += "\"stageCycles\":{";
+		uint64_t total = 0;
+		for (int i = 0; i < kStageCount; ++i)
+		{
+			std::snprintf(buf, sizeof(buf), "%s\"%s\":%llu", i ? "," : "", StageName((EnigmaStage)i), (unsigned long long)c.stageCycles[i]);
+			out += buf;
+			total += c.stageCycles[i];
+		}
+		std::snprintf(buf, sizeof(buf), "},\"cyclesPerLetter\":%.2f}", c.letters ? (double)total / (double)c.letters : 0.0);
+		out += buf;
+		return out;
+	}
+
+	// Counts letters and stepping events.
+	class CountingProbe
+	{
+	public:
+		const EngineCounters& counters() const { return m_counters; }
+		void resetCounters() { m_counters.reset(); }
+
+		void letterBegin() { ++m_counters.letters; }
+		void stageDone(EnigmaStage) {}
+		void stepped(bool rightTurnover, bool middleTurnover)
+		{
+			m_counters.rightTurnovers += rightTurnover;
+			m_counters.middleTurnovers += middleTurnover;
+			m_counters.doubleSteps += (middleTurnover && !rightTurnover);
+		}
+
+	protected:
+		EngineCounters m_counters;
+	};
+
+	// Counts events and attributes cycle counter deltas to each hot-path stage.
+	class TimingProbe : public CountingProbe
+	{
+	public:
+		void letterBegin()
+		{
+			CountingProbe::letterBegin();
+			m_last = ReadCycleCounter();
+		}
+
+		void stageDone(EnigmaStage s)
+		{
+			uint64_t now = ReadCycleCounter();
+			m_counters.stageCycles[s] += now - m_last;
+			m_last = now;
+		}
+
+	private:
+		uint64_t m_last{ 0 };
+	};
+}
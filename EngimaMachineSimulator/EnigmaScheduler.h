@@ -0,0 +1,235 @@
+// EnigmaScheduler.h - Work-stealing parallel-for over key-space ranges (C++14)
+//
+// Key-space work is uneven (early-abort scoring, bombe stops), so a static split leaves cores idle.
+// Each worker owns a deque of half-open index ranges:
+// - it takes work from the back of its own deque, splitting large ranges in half and pushing the upper
+//   half back until the piece is at most `grain` indices, so its own backlog stays available to others;
+// - an idle worker steals from the front of another worker's deque, which holds the largest ranges.
+// Deques are guarded by a per-worker mutex; the owner is almost always the only one touching it, so the
+// lock is uncontended and cheap compared to a grain of Enigma work. Each worker's state sits on its own
+// cache line (EnigmaAlign.h).
+//
+// The pool threads are created once and reused for every parallelFor call; the calling thread takes
+// part as worker 0. Threads block on condition variables whenever there is nothing to take: between calls,
+// and at the end of a call while the last pieces are still running elsewhere (woken when a busy worker
+// splits off a range or the call is done).
+
+#pragma once
+
+#include "EnigmaAlign.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace EnigmaCore
+{
+	class WorkStealingScheduler
+	{
+	public:
+		// Body is called as body(begin, end, worker) for disjoint pieces covering the whole range.
+		typedef std::function<void(uint64_t, uint64_t, unsigned)> RangeBody;
+
+		// threads = 0 uses all hardware threads.
+		explicit WorkStealingScheduler(unsigned threads = 0)
+		{
+			if (threads == 0) threads = (std::max)(1u, std::thread::hardware_concurrency());
+			for (unsigned i = 0; i < threads; ++i) m_workers.emplace_back(new Worker);
+			for (unsigned i = 1; i < threads; ++i) m_threads.emplace_back([this, i] { threadMain(i); });
+		}
+
+		~WorkStealingScheduler()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_poolMutex);
+				m_shutdown = true;
+				++m_generation;
+			}
+			m_wake.notify_all();
+			for (std::thread& t : m_threads) t.join();
+		}
+
+		WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+		WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+
+		unsigned threadCount() const { return (unsigned)m_workers.size(); }
+
+		// Number of successful steals since construction (diagnostics).
+		uint64_t steals() const { return m_steals.load(std::memory_order_relaxed); }
+
+		// Run body over [begin, end) on all workers and return when every index has been processed.
+		void parallelFor(uint64_t begin, uint64_t end, uint64_t grain, const RangeBody& body)
+		{
+			if (end <= begin) return;
+			m_grain = std::max<uint64_t>(1, grain);
+			m_body = &body;
+			m_remaining.store(end - begin);
+
+			// Seed every deque with an equal share; stealing evens out the rest.
+			const unsigned n = threadCount();
+			const uint64_t total = end - begin;
+			for (unsigned i = 0; i < n; ++i)
+			{
+				uint64_t b = begin + total * i / n, e = begin + total * (i + 1) / n;
+				if (e > b) m_workers[i]->ranges.push_back(Range{ b, e });
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_poolMutex);
+				m_active = n - 1;
+				++m_generation;
+			}
+			m_wake.notify_all();
+
+			work(0);
+
+			std::unique_lock<std::mutex> lock(m_poolMutex);
+			m_done.wait(lock, [this] { return m_active == 0; });
+			m_body = nullptr;
+		}
+
+	private:
+		struct Range
+		{
+			uint64_t begin, end;
+		};
+
+		struct alignas(kCacheLineSize) Worker : CacheLineAllocated
+		{
+			std::mutex mutex;
+			std::deque<Range> ranges;
+		};
+
+		void threadMain(unsigned id)
+		{
+			uint64_t seen = 0;
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> lock(m_poolMutex);
+					m_wake.wait(lock, [&] { return m_generation != seen; });
+					seen = m_generation;
+					if (m_shutdown) return;
+				}
+				work(id);
+				{
+					std::lock_guard<std::mutex> lock(m_poolMutex);
+					--m_active;
+				}
+				m_done.notify_one();
+			}
+		}
+
+		void work(unsigned id)
+		{
+			Range r;
+			unsigned victim = id;
+			while (m_remaining.load(std::memory_order_acquire) > 0)
+			{
+				if (!popLocal(id, r))
+				{
+					const uint64_t pushed = m_pushes.load();
+					if (!steal(id, victim, r))
+					{
+						waitForWork(pushed);
+						continue;
+					}
+				}
+				while (r.end - r.begin > m_grain)
+				{
+					uint64_t mid = r.begin + (r.end - r.begin) / 2;
+					pushLocal(id, Range{ mid, r.end });
+					r.end = mid;
+				}
+				(*m_body)(r.begin, r.end, id);
+				if (m_remaining.fetch_sub(r.end - r.begin, std::memory_order_acq_rel) == r.end - r.begin)
+					wakeIdle(true);
+			}
+		}
+
+		// Block until a range has been pushed since `pushed` was read, or the call is done. The counters are
+		// updated before the waker reads m_idle, and read after the sleeper raised it, so no wakeup is lost.
+		void waitForWork(uint64_t pushed)
+		{
+			std::unique_lock<std::mutex> lock(m_idleMutex);
+			++m_idle;
+			m_work.wait(lock, [&] { return m_pushes.load() != pushed || m_remaining.load() == 0; });
+			--m_idle;
+		}
+
+		void wakeIdle(bool all)
+		{
+			if (m_idle.load() == 0) return;
+			std::lock_guard<std::mutex> lock(m_idleMutex);
+			if (all) m_work.notify_all();
+			else m_work.notify_one();
+		}
+
+		bool popLocal(unsigned id, Range& r)
+		{
+			Worker& w = *m_workers[id];
+			std::lock_guard<std::mutex> lock(w.mutex);
+			if (w.ranges.empty()) return false;
+			r = w.ranges.back();
+			w.ranges.pop_back();
+			return true;
+		}
+
+		void pushLocal(unsigned id, const Range& r)
+		{
+			Worker& w = *m_workers[id];
+			{
+				std::lock_guard<std::mutex> lock(w.mutex);
+				w.ranges.push_back(r);
+			}
+			m_pushes.fetch_add(1);
+			wakeIdle(false);
+		}
+
+		// Round-robin over the other workers, taking the oldest (largest) range from the front.
+		bool steal(unsigned id, unsigned& victim, Range& r)
+		{
+			const unsigned n = threadCount();
+			for (unsigned k = 0; k < n; ++k)
+			{
+				victim = (victim + 1) % n;
+				if (victim == id) continue;
+				Worker& w = *m_workers[victim];
+				std::lock_guard<std::mutex> lock(w.mutex);
+				if (w.ranges.empty()) continue;
+				r = w.ranges.front();
+				w.ranges.pop_front();
+				m_steals.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+			return false;
+		}
+
+		std::vector<std::unique_ptr<Worker>> m_workers;
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_poolMutex;
+		std::condition_variable m_wake, m_done;
+		uint64_t m_generation{ 0 };
+		unsigned m_active{ 0 };
+		bool m_shutdown{ false };
+
+		const RangeBody* m_body{ nullptr };
+		uint64_t m_grain{ 1 };
+		std::atomic<uint64_t> m_remaining{ 0 };
+		std::atomic<uint64_t> m_steals{ 0 };
+
+		// Workers with nothing to take wait on m_work; m_pushes counts ranges split off for others to steal.
+		std::mutex m_idleMutex;
+		std::condition_variable m_work;
+		std::atomic<unsigned> m_idle{ 0 };
+		std::atomic<uint64_t> m_pushes{ 0 };
+	};
+}
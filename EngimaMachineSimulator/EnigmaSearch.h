@@ -0,0 +1,576 @@
+// EnigmaSearch.h - Ciphertext-only key search with checkpoint/resume (C++14)
+//
+// The search runs in two phases:
+// 1. Enumeration: every key in the configured key space (reflector, rotor order, middle/right rings,
+//    start positions) decrypts the ciphertext with an empty plugboard and is scored by index of coincidence.
+//    Keys are decrypted in batches through the dispatcher's many-keys path (EnigmaDispatch.h), so the fastest
+//    engine on this CPU does the work, and the best topK keys are kept. The key space is walked in epochs; each
+//    epoch is spread over the worker threads by the work-stealing scheduler (EnigmaScheduler.h) and candidates
+//    are collected in a ConcurrentTopK (EnigmaTopK.h). Epoch boundaries are where stop requests and checkpoints
+//    are handled.
+// 2. Annealing: for each top key, a simulated-annealing walk over plugboard pairings maximises the same score.
+//
+// A stored corpus can be passed packed (EnigmaPacked.h, SearchConfig::packedCiphertext); it is unpacked once,
+// since the scoring loop runs fastest on one letter index per byte.
+//
+// Scores are integer coincidence counts (sum of c*(c-1) over letter counts), so results compare exactly and
+// ties are broken by key index: a run is fully deterministic for a given configuration and seed.
+//
+// Long runs persist their progress to SearchConfig::checkpointPath: the enumeration cursor, the current top-K,
+// the annealing cursor with its current/best plugboards and the RNG state. run() picks up a matching checkpoint
+// and finishes with exactly the result an uninterrupted run would give. Checkpoints are written at most once per
+// checkpointSeconds, to a temp file that is then renamed over the old one. The clock is only read between
+// enumeration epochs (kEpochKeysPerThread keys per thread) and every few hundred annealing steps, so on a slow
+// machine a checkpoint can come one epoch late. A write that fails or comes up short leaves the previous
+// checkpoint in place.
+
+#pragma once
+
+#include "Enigma.h"
+#include "EnigmaDispatch.h"
+#include "EnigmaPacked.h"
+#include "EnigmaScheduler.h"
+#include "EnigmaState.h"
+#include "EnigmaTopK.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace EnigmaCore
+{
+	// Key space enumerated in phase 1. Key indices are mixed-radix, fastest-changing digit first:
+	// right position, middle position, left position, [right ring, middle ring,] rotor order, [reflector].
+	struct KeySpace
+	{
+		bool bothReflectors{ false }; // otherwise reflector B only
+		bool searchRings{ false }; // otherwise all rings at A
+
+		static const int kRotorOrders = 60; // ordered choices of 3 out of rotors I..V
+
+		uint64_t size() const
+		{
+			uint64_t n = 26ull * 26 * 26 * kRotorOrders;
+			if (searchRings) n *= 26 * 26;
+			if (bothReflectors) n *= 2;
+			return n;
+		}
+
+		void decode(uint64_t index, MachineState& st) const
+		{
+			st.positions[2] = (uint8_t)(index % 26); index /= 26;
+			st.positions[1] = (uint8_t)(index % 26); index /= 26;
+			st.positions[0] = (uint8_t)(index % 26); index /= 26;
+			st.rings[0] = st.rings[1] = st.rings[2] = 0;
+			if (searchRings)
+			{
+				st.rings[2] = (uint8_t)(index % 26); index /= 26;
+				st.rings[1] = (uint8_t)(index % 26); index /= 26;
+			}
+			int order = (int)(index % kRotorOrders); index /= kRotorOrders;
+			int l = order / 12, rest = order % 12;
+			int m = rest / 3, r = rest % 3;
+			// pick l from 5, then m from the remaining 4, then r from the remaining 3
+			int avail[5] = { 0, 1, 2, 3, 4 };
+			st.rotors[0] = (uint8_t)avail[l]; std::copy(avail + l + 1, avail + 5, avail + l);
+			st.rotors[1] = (uint8_t)avail[m]; std::copy(avail + m + 1, avail + 4, avail + m);
+			st.rotors[2] = (uint8_t)avail[r];
+			st.reflector = (uint8_t)(bothReflectors ? index % 2 : 0);
+			for (int i = 0; i < 26; ++i) st.plug[i] = (uint8_t)i;
+		}
+	};
+
+	// Standard components looked up once per search instead of once per key (copies share compiled wirings).
+	class ComponentSet
+	{
+	public:
+		ComponentSet()
+		{
+			for (int i = 0; i < kBuiltinRotorCount; ++i) m_rotors[i] = RotorByIndex(i);
+			for (int i = 0; i < kBuiltinReflectorCount; ++i) m_reflectors[i] = ReflectorByIndex(i);
+		}
+
+		// False, leaving em untouched, if the state names a component that is not built in or is an M4 state.
+		bool build(const MachineState& st, EnigmaMachine& em) const
+		{
+			if (st.reflector >= kBuiltinReflectorCount || IsM4State(st)) return false;
+			for (int i = 0; i < 3; ++i)
+			{
+				if (st.rotors[i] >= kBuiltinRotorCount) return false;
+			}
+			Rotor r[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				r[i] = m_rotors[st.rotors[i]];
+				r[i].setRing(st.rings[i]);
+				r[i].setPosition(st.positions[i]);
+			}
+			Plugboard plug;
+			for (int i = 0; i < 26; ++i)
+			{
+				if (st.plug[i] > i) plug.connect(i, st.plug[i]);
+			}
+			em.setReflector(m_reflectors[st.reflector]);
+			em.setRotors(r[0], r[1], r[2]);
+			em.setPlugboard(plug);
+			return true;
+		}
+
+	private:
+		Rotor m_rotors[kBuiltinRotorCount];
+		Reflector m_reflectors[kBuiltinReflectorCount];
+	};
+
+	// Coincidence count of decrypted letters: sum over letters of c*(c-1). IoC = score / (n*(n-1)).
+	inline uint64_t ScoreLetters(const uint8_t* letters, size_t n)
+	{
+		uint32_t counts[26] = {};
+		for (size_t i = 0; i < n; ++i) ++counts[letters[i]];
+		uint64_t score = 0;
+		for (uint32_t c : counts) score += (uint64_t)c * (c ? c - 1 : 0);
+		return score;
+	}
+
+	// Coincidence count of the decrypt under one key; em is advanced.
+	inline uint64_t ScoreCoincidences(EnigmaMachine& em, const uint8_t* text, size_t n)
+	{
+		uint32_t counts[26] = {};
+		for (size_t i = 0; i < n; ++i) ++counts[em.encryptIndex(text[i])];
+		uint64_t score = 0;
+		for (uint32_t c : counts) score += (uint64_t)c * (c ? c - 1 : 0);
+		return score;
+	}
+
+	struct SearchCandidate
+	{
+		uint64_t key{ 0 }; // index in the KeySpace
+		uint64_t score{ 0 };
+		uint8_t plug[26]{}; // plugboard found in phase 2 (all zero before)
+
+		// Strict ordering used for top-K: higher score first, then lower key index.
+		bool betterThan(const SearchCandidate& o) const
+		{
+			return score != o.score ? score > o.score : key < o.key;
+		}
+	};
+
+	// Scores runs of consecutive keys through the dispatcher's many-keys path, kBatch keys per call. The engine
+	// is chosen once, at construction; use one scorer per thread or process.
+	class KeyBatchScorer
+	{
+	public:
+		static const size_t kBatch = 64;
+
+		explicit KeyBatchScorer(const std::vector<uint8_t>& text)
+			: KeyBatchScorer(text, EngineDispatcher::instance().choose(kShapeManyKeys, text.size()))
+		{
+		}
+
+		// With an engine chosen earlier; takes no lock, so a forked worker can build one.
+		KeyBatchScorer(const std::vector<uint8_t>& text, EngineKind engine)
+			: m_text(&text)
+			, m_engine(engine)
+			, m_machines(kBatch)
+			, m_out(kBatch * text.size())
+		{
+		}
+
+		// Calls offer(candidate) for every key in [b, e), in key order.
+		template <class Offer>
+		void score(const KeySpace& space, const ComponentSet& components, uint64_t b, uint64_t e, Offer offer)
+		{
+			const size_t len = m_text->size();
+			MachineState st;
+			while (b < e)
+			{
+				const size_t n = (size_t)(std::min)((uint64_t)kBatch, e - b);
+				for (size_t j = 0; j < n; ++j)
+				{
+					space.decode(b + j, st);
+					components.build(st, m_machines[j]);
+				}
+				EngineDispatcher::encryptManyKeys(m_engine, m_machines.data(), n, m_text->data(), len, m_out.data());
+				for (size_t j = 0; j < n; ++j)
+				{
+					SearchCandidate c;
+					c.key = b + j;
+					c.score = ScoreLetters(m_out.data() + j * len, len);
+					offer(c);
+				}
+				b += n;
+			}
+		}
+
+	private:
+		const std::vector<uint8_t>* m_text;
+		EngineKind m_engine;
+		std::vector<EnigmaMachine> m_machines;
+		std::vector<uint8_t> m_out;
+	};
+
+	struct SearchConfig
+	{
+		std::string ciphertext; // letters only are used
+		PackedText packedCiphertext; // a stored corpus; used instead of ciphertext if not empty
+		KeySpace space;
+		size_t topK{ 10 };
+		int annealIterations{ 20000 };
+		double annealStartTemp{ 0.002 }; // in IoC units
+		int maxPlugPairs{ 10 };
+		uint64_t seed{ 1 };
+		unsigned threads{ 1 }; // enumeration threads, 0 = all hardware threads
+
+		std::string checkpointPath; // empty = no checkpoints
+		double checkpointSeconds{ 30.0 };
+	};
+
+	struct SearchResult
+	{
+		bool complete{ false }; // false if stopped early (progress is in the checkpoint)
+		std::vector<SearchCandidate> candidates; // best first
+	};
+
+	class KeySearch
+	{
+	public:
+		explicit KeySearch(const SearchConfig& cfg)
+			: m_cfg(cfg)
+		{
+			if (!cfg.packedCiphertext.empty())
+				m_text = cfg.packedCiphertext.letters();
+			else
+			{
+				for (char c : cfg.ciphertext)
+				{
+					int i = ch2i(c);
+					if (i != -1) m_text.push_back((uint8_t)i);
+				}
+			}
+			if (m_cfg.topK == 0) m_cfg.topK = 1;
+		}
+
+		// Ask the search to stop at the next cursor boundary; it writes a checkpoint first. A request made before
+		// run() starts stops that run; each request stops one run, so a later run() resumes.
+		void requestStop() { m_stop.store(true, std::memory_order_relaxed); }
+
+		// Run the search, resuming from the checkpoint file if it belongs to this configuration.
+		SearchResult run()
+		{
+			resetProgress();
+			if (!m_cfg.checkpointPath.empty()) loadCheckpoint();
+			m_lastCheckpoint = Clock::now();
+
+			SearchResult res;
+			if (m_phase == 0 && !enumerate()) { saveCheckpoint(); return res; }
+			if (m_phase == 1 && !anneal()) { saveCheckpoint(); return res; }
+
+			res.complete = true;
+			res.candidates = m_top.sorted();
+			if (!m_cfg.checkpointPath.empty()) saveCheckpoint();
+			return res;
+		}
+
+		uint64_t keysDone() const { return m_cursor; }
+		const SearchConfig& config() const { return m_cfg; }
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+		static const uint32_t kCheckpointVersion = 1;
+		static const uint64_t kCheckEvery = 4096; // annealing steps between clock reads
+		static const uint64_t kEpochKeysPerThread = 1 << 16; // keys per thread between stop/checkpoint checks
+		static const uint64_t kGrain = 256; // smallest range a worker splits down to
+
+		// Phase 1. Returns false if stopped.
+		bool enumerate()
+		{
+			const uint64_t total = m_cfg.space.size();
+			if (!m_scheduler) m_scheduler.reset(new WorkStealingScheduler(m_cfg.threads));
+			const unsigned nThreads = m_scheduler->threadCount();
+			ConcurrentTopK<SearchCandidate> collector(m_cfg.topK, nThreads);
+			for (const SearchCandidate& c : m_top.items()) collector.offer(0, c); // resumed progress
+			std::vector<KeyBatchScorer> scorers(nThreads, KeyBatchScorer(m_text));
+
+			WorkStealingScheduler::RangeBody body = [&](uint64_t b, uint64_t e, unsigned w)
+			{
+				scorers[w].score(m_cfg.space, m_components, b, e,
+					[&](const SearchCandidate& c) { collector.offer(w, c); });
+			};
+
+			while (m_cursor < total)
+			{
+				uint64_t end = (std::min)(total, m_cursor + kEpochKeysPerThread * nThreads);
+				m_scheduler->parallelFor(m_cursor, end, kGrain, body);
+				m_top.assign(collector.result());
+				m_cursor = end;
+				if (!tick()) return false;
+			}
+			// Phase 2 walks the candidates best-first; the order is fixed from here on.
+			std::vector<SearchCandidate>& top = m_top.items();
+			std::sort(top.begin(), top.end(),
+				[](const SearchCandidate& a, const SearchCandidate& b) { return a.betterThan(b); });
+			m_phase = 1;
+			m_annealIndex = 0;
+			m_annealIter = -1;
+			return true;
+		}
+
+		// Phase 2. Returns false if stopped.
+		bool anneal()
+		{
+			const double norm = m_text.size() > 1 ? 1.0 / ((double)m_text.size() * (double)(m_text.size() - 1)) : 0.0;
+			EnigmaMachine em;
+			MachineState st;
+			std::vector<SearchCandidate>& top = m_top.items();
+			for (; m_annealIndex < top.size(); ++m_annealIndex)
+			{
+				SearchCandidate& cand = top[m_annealIndex];
+				m_cfg.space.decode(cand.key, st);
+				if (m_annealIter < 0)
+				{
+					for (int i = 0; i < 26; ++i) m_curPlug[i] = m_bestPlug[i] = (uint8_t)i;
+					m_curScore = m_bestScore = cand.score;
+					m_annealIter = 0;
+				}
+				while (m_annealIter < m_cfg.annealIterations)
+				{
+					int stepEnd = (std::min)(m_cfg.annealIterations, m_annealIter + (int)kCheckEvery / 16);
+					for (; m_annealIter < stepEnd; ++m_annealIter)
+					{
+						uint8_t trial[26];
+						if (!propose(trial)) continue;
+						std::memcpy(st.plug, trial, 26);
+						m_components.build(st, em);
+						uint64_t s = ScoreCoincidences(em, m_text.data(), m_text.size());
+						double delta = ((double)s - (double)m_curScore) * norm;
+						double temp = m_cfg.annealStartTemp * (1.0 - (double)m_annealIter / m_cfg.annealIterations);
+						double u = uniform();
+						if (delta >= 0 || (temp > 0 && u < std::exp(delta / temp)))
+						{
+							std::memcpy(m_curPlug, trial, 26);
+							m_curScore = s;
+							if (s > m_bestScore)
+							{
+								std::memcpy(m_bestPlug, trial, 26);
+								m_bestScore = s;
+							}
+						}
+					}
+					if (!tick()) return false;
+				}
+				cand.score = m_bestScore;
+				std::memcpy(cand.plug, m_bestPlug, 26);
+				m_annealIter = -1;
+			}
+			m_phase = 2;
+			return true;
+		}
+
+		// Random plugboard move from the current pairing: toggle the pair (a, b), unplugging their old partners.
+		bool propose(uint8_t trial[26])
+		{
+			int a = (int)(m_rng() % 26), b = (int)(m_rng() % 26);
+			if (a == b) return false;
+			std::memcpy(trial, m_curPlug, 26);
+			if (trial[a] == b)
+			{
+				trial[a] = (uint8_t)a; trial[b] = (uint8_t)b;
+				return true;
+			}
+			int pa = trial[a], pb = trial[b];
+			trial[pa] = (uint8_t)pa; trial[a] = (uint8_t)a;
+			trial[pb] = (uint8_t)pb; trial[b] = (uint8_t)b;
+			trial[a] = (uint8_t)b; trial[b] = (uint8_t)a;
+			int pairs = 0;
+			for (int i = 0; i < 26; ++i) pairs += trial[i] > i;
+			return pairs <= m_cfg.maxPlugPairs;
+		}
+
+		double uniform() { return (double)(m_rng() >> 11) * (1.0 / 9007199254740992.0); }
+
+		// Called between enumeration epochs and annealing steps: honours stop requests and writes periodic checkpoints.
+		bool tick()
+		{
+			if (m_stop.load(std::memory_order_relaxed) && m_stop.exchange(false)) return false;
+			if (m_cfg.checkpointPath.empty()) return true;
+			Clock::time_point now = Clock::now();
+			if (std::chrono::duration<double>(now - m_lastCheckpoint).count() >= m_cfg.checkpointSeconds)
+			{
+				saveCheckpoint();
+				m_lastCheckpoint = now;
+			}
+			return true;
+		}
+
+		void resetProgress()
+		{
+			m_phase = 0;
+			m_cursor = 0;
+			m_top = BoundedTopK<SearchCandidate>(m_cfg.topK);
+			m_annealIndex = 0;
+			m_annealIter = -1;
+			m_rng.seed(m_cfg.seed);
+		}
+
+		// Identifies the configuration a checkpoint belongs to.
+		uint64_t fingerprint() const
+		{
+			uint64_t h = 1469598103934665603ull;
+			auto mix = [&h](uint64_t v) { for (int i = 0; i < 8; ++i) { h ^= (v >> (8 * i)) & 0xFF; h *= 1099511628211ull; } };
+			for (uint8_t c : m_text) mix(c);
+			mix(m_text.size());
+			mix(m_cfg.space.bothReflectors); mix(m_cfg.space.searchRings);
+			mix(m_cfg.topK); mix((uint64_t)m_cfg.annealIterations); mix((uint64_t)m_cfg.maxPlugPairs);
+			uint64_t t; std::memcpy(&t, &m_cfg.annealStartTemp, 8); mix(t);
+			mix(m_cfg.seed);
+			return h;
+		}
+
+		// A plugboard: letters 0..25, each either unplugged or swapped with a partner that maps back.
+		static bool isPairing(const uint8_t p[26])
+		{
+			for (int i = 0; i < 26; ++i)
+			{
+				if (p[i] > 25 || p[p[i]] != i) return false;
+			}
+			return true;
+		}
+
+		static void put64(std::string& out, uint64_t v) { for (int i = 0; i < 8; ++i) out.push_back((char)((v >> (8 * i)) & 0xFF)); }
+		static bool get64(const std::string& in, size_t& pos, uint64_t& v)
+		{
+			if (pos + 8 > in.size()) return false;
+			v = 0;
+			for (int i = 0; i < 8; ++i) v |= (uint64_t)(unsigned char)in[pos + i] << (8 * i);
+			pos += 8;
+			return true;
+		}
+
+		void saveCheckpoint()
+		{
+			if (m_cfg.checkpointPath.empty()) return;
+			std::string out("ENGK", 4);
+			put64(out, kCheckpointVersion);
+			put64(out, fingerprint());
+			put64(out, (uint64_t)m_phase);
+			put64(out, m_cursor);
+			put64(out, m_top.items().size());
+			for (const SearchCandidate& c : m_top.items())
+			{
+				put64(out, c.key);
+				put64(out, c.score);
+				out.append(reinterpret_cast<const char*>(c.plug), 26);
+			}
+			put64(out, m_annealIndex);
+			put64(out, (uint64_t)(int64_t)m_annealIter);
+			put64(out, m_curScore);
+			put64(out, m_bestScore);
+			out.append(reinterpret_cast<const char*>(m_curPlug), 26);
+			out.append(reinterpret_cast<const char*>(m_bestPlug), 26);
+			std::ostringstream rng;
+			rng << m_rng;
+			put64(out, rng.str().size());
+			out += rng.str();
+
+			std::string tmp = m_cfg.checkpointPath + ".tmp";
+			{
+				std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+				f.write(out.data(), (std::streamsize)out.size());
+				f.close(); // the final flush can fail too (disk full, quota)
+				if (!f) return;
+			}
+#if defined(_WIN32)
+			// rename does not replace on Windows; remove-then-rename would leave no checkpoint in between.
+			::MoveFileExA(tmp.c_str(), m_cfg.checkpointPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+			std::rename(tmp.c_str(), m_cfg.checkpointPath.c_str());
+#endif
+		}
+
+		// Restores progress if the checkpoint exists and matches this configuration; otherwise starts fresh.
+		bool loadCheckpoint()
+		{
+			std::ifstream f(m_cfg.checkpointPath, std::ios::binary);
+			if (!f) return false;
+			std::string in((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+			size_t pos = 4;
+			uint64_t version, fp, phase, cursor, count;
+			if (in.compare(0, 4, "ENGK") != 0 || !get64(in, pos, version) || version != kCheckpointVersion) return false;
+			if (!get64(in, pos, fp) || fp != fingerprint()) return false;
+			if (!get64(in, pos, phase) || !get64(in, pos, cursor) || !get64(in, pos, count)) return false;
+			if (phase > 2 || cursor > m_cfg.space.size() || count > m_cfg.topK) return false;
+			std::vector<SearchCandidate> top((size_t)count);
+			for (SearchCandidate& c : top)
+			{
+				if (!get64(in, pos, c.key) || !get64(in, pos, c.score) || pos + 26 > in.size()) return false;
+				std::memcpy(c.plug, in.data() + pos, 26); pos += 26;
+			}
+			uint64_t annealIndex, annealIter, curScore, bestScore, rngLen;
+			if (!get64(in, pos, annealIndex) || !get64(in, pos, annealIter) || !get64(in, pos, curScore) || !get64(in, pos, bestScore)) return false;
+			if (pos + 52 > in.size()) return false;
+			uint8_t curPlug[26], bestPlug[26];
+			std::memcpy(curPlug, in.data() + pos, 26); pos += 26;
+			std::memcpy(bestPlug, in.data() + pos, 26); pos += 26;
+			// The fingerprint only says which search this was; the progress itself must be in range too.
+			// Plugboards are checked where they are in use: annealed candidates and a walk in progress.
+			const int64_t iter = (int64_t)annealIter;
+			if (annealIndex > count || iter < -1 || iter > m_cfg.annealIterations) return false;
+			if (phase == 0 && (annealIndex != 0 || iter != -1)) return false;
+			if (phase == 1 && iter >= 0 && (annealIndex == count || !isPairing(curPlug) || !isPairing(bestPlug))) return false;
+			for (size_t i = 0; i < top.size(); ++i)
+			{
+				if (top[i].key >= m_cfg.space.size()) return false;
+				if ((phase == 2 || (phase == 1 && i < annealIndex)) && !isPairing(top[i].plug)) return false;
+			}
+			if (!get64(in, pos, rngLen) || pos + rngLen > in.size()) return false;
+			std::istringstream rngIn(in.substr(pos, (size_t)rngLen));
+			std::mt19937_64 rng;
+			if (!(rngIn >> rng)) return false;
+
+			m_phase = (int)phase;
+			m_cursor = cursor;
+			if (m_phase == 0)
+				m_top.assign(top);
+			else
+				m_top.items().swap(top);
+			m_annealIndex = (size_t)annealIndex;
+			m_annealIter = (int)iter;
+			m_curScore = curScore;
+			m_bestScore = bestScore;
+			std::memcpy(m_curPlug, curPlug, 26);
+			std::memcpy(m_bestPlug, bestPlug, 26);
+			m_rng = rng;
+			return true;
+		}
+
+		SearchConfig m_cfg;
+		std::vector<uint8_t> m_text;
+		ComponentSet m_components;
+		std::unique_ptr<WorkStealingScheduler> m_scheduler;
+		std::atomic<bool> m_stop{ false };
+		Clock::time_point m_lastCheckpoint;
+
+		// Progress (everything below is what a checkpoint stores)
+		int m_phase{ 0 }; // 0 = enumerating, 1 = annealing, 2 = done
+		uint64_t m_cursor{ 0 }; // next key index to enumerate
+		BoundedTopK<SearchCandidate> m_top;
+		size_t m_annealIndex{ 0 }; // candidate being annealed (in best-first order)
+		int m_annealIter{ -1 }; // -1 = candidate not started
+		uint64_t m_curScore{ 0 }, m_bestScore{ 0 };
+		uint8_t m_curPlug[26]{}, m_bestPlug[26]{};
+		std::mt19937_64 m_rng;
+	};
+}
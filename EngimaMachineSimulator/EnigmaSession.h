@@ -0,0 +1,290 @@
+// EnigmaSession.h - Live typing with O(1) backspace, and incremental re-encryption of edited text (C++14)
+//
+// A TypingSession is a machine being typed on: it keeps the key it started from, the text typed so far, its
+// encryption, and a journal with one byte per typed character saying what that key press moved (see
+// BasicEnigmaMachineN::step/unstep). Typing a character and taking it back are both O(1), so an editor whose
+// text only changes near the end does not need to encrypt the whole text again:
+//
+//   session.type('A');            // one key press; returns the lamp
+//   session.backspace();          // takes it back, rotors included
+//   size_t from = session.setText(editText); // typed text becomes editText; output changed from `from` on
+//
+// An IncrementalSession is for edits anywhere in a long text. It keeps the machine state every K letters
+// (checkpoints) next to the plaintext and ciphertext. setText(newText) finds the changed range (common prefix
+// and suffix), restores the last checkpoint before it, steps to the change without encrypting (< K letters),
+// and encrypts from there:
+// - if the changed range has as many letters as before (overtyping a letter, editing spaces or punctuation),
+//   the suffix keeps its key stream, so only the range is encrypted and the suffix's checkpoints just move;
+// - otherwise every later letter sits at a different machine position and the rest of the text is encrypted
+//   again (one pass over the suffix, no work on the prefix).
+// apply(edit) does the same for an edit already known as a TextPatch (EnigmaText.h), without comparing texts.
+// Both return the change to the ciphertext as a TextPatch, so a view can replace just that part of its
+// ciphertext. The plaintext is kept in a PieceTable; setKey() encrypts it again under another key.
+//
+// Characters follow EnigmaMachine::encrypt: letters (either case) step the machine and come out upper case,
+// everything else is copied and leaves the rotors alone. An IncrementalSession works on any character type
+// ch2i() takes (BasicIncrementalSession<Machine, wchar_t> for a UTF-16 editor), so a caller keeps its text as is.
+
+#pragma once
+
+#include "Enigma.h"
+#include "EnigmaText.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace EnigmaCore
+{
+	template <class Machine>
+	class BasicTypingSession
+	{
+		static_assert(Machine::kRotors < 7, "a journal byte holds the rotor and reflector bits");
+	public:
+		explicit BasicTypingSession(const Machine& key = Machine()) : m_key(key), m_machine(key) {}
+
+		// Start over from `key` with no text.
+		void reset(const Machine& key)
+		{
+			m_key = key;
+			clear();
+		}
+		void clear()
+		{
+			m_machine = m_key;
+			m_plain.clear();
+			m_cipher.clear();
+			m_journal.clear();
+		}
+
+		char type(char c)
+		{
+			char out = c;
+			uint8_t entry = kNotALetter;
+			const int i = ch2i(c);
+			if (i >= 0)
+			{
+				uint32_t moved = 0;
+				out = (char)('A' + m_machine.encryptIndex(i, moved));
+				entry = (uint8_t)moved;
+			}
+			m_plain.push_back(c);
+			m_cipher.push_back(out);
+			m_journal.push_back(entry);
+			return out;
+		}
+		void type(const std::string& text)
+		{
+			m_plain.reserve(m_plain.size() + text.size());
+			m_cipher.reserve(m_cipher.size() + text.size());
+			m_journal.reserve(m_journal.size() + text.size());
+			for (char c : text) type(c);
+		}
+
+		// Take back the last typed character. Returns false if there is none.
+		bool backspace()
+		{
+			if (m_journal.empty()) return false;
+			if (m_journal.back() != kNotALetter) m_machine.unstep(m_journal.back());
+			m_journal.pop_back();
+			m_plain.pop_back();
+			m_cipher.pop_back();
+			return true;
+		}
+		// Take back up to n characters; returns how many were removed.
+		size_t backspace(size_t n)
+		{
+			size_t done = 0;
+			while (done < n && backspace()) ++done;
+			return done;
+		}
+
+		// Make the typed text `text`: keep the common prefix, take back the rest, type the new tail. Costs the
+		// length of the changed tail rather than of the text. Returns the first index at which ciphertext()
+		// may differ from before.
+		size_t setText(const std::string& text)
+		{
+			size_t keep = 0;
+			const size_t limit = text.size() < m_plain.size() ? text.size() : m_plain.size();
+			while (keep < limit && text[keep] == m_plain[keep]) ++keep;
+			backspace(m_plain.size() - keep);
+			for (size_t i = keep; i < text.size(); ++i) type(text[i]);
+			return keep;
+		}
+
+		const std::string& plaintext() const { return m_plain; }
+		const std::string& ciphertext() const { return m_cipher; }
+		size_t size() const { return m_plain.size(); }
+		const Machine& key() const { return m_key; } // the machine before the first character
+		const Machine& machine() const { return m_machine; } // the machine after the last character
+
+	private:
+		static const uint8_t kNotALetter = 0x80;
+
+		Machine m_key;
+		Machine m_machine;
+		std::string m_plain, m_cipher;
+		std::vector<uint8_t> m_journal; // per character: what its key press moved (step()), or kNotALetter
+	};
+
+	typedef BasicTypingSession<EnigmaMachine> TypingSession;
+
+	template <class Machine, class CharT = char>
+	class BasicIncrementalSession
+	{
+	public:
+		typedef CharT Char;
+		typedef std::basic_string<CharT> String;
+		typedef BasicTextPatch<CharT> Patch;
+		typedef BasicPieceTable<CharT> Text;
+
+		static const size_t kDefaultCheckpointInterval = 4096; // letters
+
+		explicit BasicIncrementalSession(const Machine& key = Machine(), size_t checkpointInterval = kDefaultCheckpointInterval)
+			: m_interval(checkpointInterval ? checkpointInterval : 1)
+		{
+			reset(key);
+		}
+
+		// Start over from `key` with no text.
+		void reset(const Machine& key)
+		{
+			m_plain.clear();
+			m_cipher.clear();
+			m_checkpoints.assign(1, Checkpoint{ 0, 0, key });
+			m_end = key;
+			m_letters = 0;
+		}
+
+		// Encrypt the same text under a new key.
+		void setKey(const Machine& key)
+		{
+			m_checkpoints.assign(1, Checkpoint{ 0, 0, key });
+			m_end = key;
+			m_letters = 0;
+			m_cipher.clear();
+			m_plain.forEach(0, m_plain.size(), [&](const CharT* p, size_t n) { encrypt(m_end, m_letters, p, n, m_cipher.size(), m_cipher); });
+		}
+
+		// Make the text `text`. Returns how ciphertext() changed.
+		Patch setText(const String& text) { return apply(m_plain.diff(text)); }
+
+		// Edit the text. Returns how ciphertext() changed.
+		Patch apply(const Patch& edit)
+		{
+			const size_t oldSize = m_plain.size();
+			const size_t prefix = (std::min)(edit.offset, oldSize);
+			const size_t oldEnd = prefix + (std::min)(edit.removed, oldSize - prefix);
+			const size_t newEnd = prefix + edit.inserted.size();
+
+			Patch patch;
+			patch.offset = prefix;
+			if (prefix == oldEnd && prefix == newEnd) return patch;
+
+			// The machine at `prefix`: the end state when appending, else the last checkpoint before it
+			Machine em = m_end;
+			uint64_t letters = m_letters;
+			size_t keep = m_checkpoints.size();
+			if (prefix < oldSize)
+			{
+				auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), prefix,
+					[](size_t offset, const Checkpoint& c) { return offset < c.offset; });
+				--it; // the first checkpoint is at offset 0
+				keep = (size_t)(it - m_checkpoints.begin()) + 1;
+				em = it->state;
+				letters = it->letters;
+				m_plain.forEach(it->offset, prefix, [&](const CharT* p, size_t n)
+				{
+					for (size_t i = 0; i < n; ++i)
+					{
+						if (ch2i(p[i]) >= 0)
+						{
+							em.step();
+							++letters;
+						}
+					}
+				});
+			}
+
+			uint64_t removedLetters = 0;
+			m_plain.forEach(prefix, oldEnd, [&](const CharT* p, size_t n) { removedLetters += countLetters(p, n); });
+			if (countLetters(edit.inserted.data(), edit.inserted.size()) == removedLetters)
+			{
+				// Same number of letters: the suffix is encrypted exactly as before, and the end state stays.
+				std::vector<Checkpoint> later;
+				for (size_t i = keep; i < m_checkpoints.size(); ++i)
+				{
+					if (m_checkpoints[i].offset > oldEnd)
+					{
+						later.push_back(m_checkpoints[i]);
+						later.back().offset = later.back().offset - oldEnd + newEnd;
+					}
+				}
+				m_checkpoints.resize(keep);
+				encrypt(em, letters, edit.inserted.data(), edit.inserted.size(), prefix, patch.inserted);
+				m_checkpoints.insert(m_checkpoints.end(), later.begin(), later.end());
+				patch.removed = oldEnd - prefix;
+			}
+			else
+			{
+				// Every later letter moves: encrypt the insertion and then the old text after the edit
+				m_checkpoints.resize(keep);
+				encrypt(em, letters, edit.inserted.data(), edit.inserted.size(), prefix, patch.inserted);
+				m_plain.forEach(oldEnd, oldSize, [&](const CharT* p, size_t n) { encrypt(em, letters, p, n, prefix + patch.inserted.size(), patch.inserted); });
+				m_end = em;
+				m_letters = letters;
+				patch.removed = oldSize - prefix;
+			}
+			m_plain.replace(prefix, oldEnd - prefix, edit.inserted.data(), edit.inserted.size());
+			patch.applyTo(m_cipher);
+			return patch;
+		}
+
+		const Text& plaintext() const { return m_plain; }
+		const String& ciphertext() const { return m_cipher; }
+		size_t checkpointCount() const { return m_checkpoints.size(); }
+
+	private:
+		struct Checkpoint
+		{
+			size_t offset; // text offset: the state is the machine after every letter before it
+			uint64_t letters; // how many letters that is (a multiple of the interval)
+			Machine state;
+		};
+
+		static uint64_t countLetters(const CharT* s, size_t n)
+		{
+			uint64_t letters = 0;
+			for (size_t i = 0; i < n; ++i) letters += ch2i(s[i]) >= 0;
+			return letters;
+		}
+
+		// Encrypt s[0, n), which starts at text offset `offset`, onto out, adding a checkpoint after every
+		// interval-th letter
+		void encrypt(Machine& em, uint64_t& letters, const CharT* s, size_t n, size_t offset, String& out)
+		{
+			out.reserve(out.size() + n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				const int x = ch2i(s[i]);
+				if (x < 0)
+				{
+					out.push_back(s[i]);
+					continue;
+				}
+				out.push_back((CharT)('A' + em.encryptIndex(x)));
+				if (++letters % m_interval == 0) m_checkpoints.push_back(Checkpoint{ offset + i + 1, letters, em });
+			}
+		}
+
+		size_t m_interval;
+		Text m_plain;
+		String m_cipher;
+		std::vector<Checkpoint> m_checkpoints; // by offset; the first is the key at offset 0
+		Machine m_end; // after the whole text
+		uint64_t m_letters{ 0 }; // letters in the whole text
+	};
+
+	typedef BasicIncrementalSession<EnigmaMachine> IncrementalSession;
+}
@@ -0,0 +1,243 @@
+// EnigmaShardSearch.h - Multi-process sharded key enumeration over a shared-memory result ring (Linux, C++14)
+//
+// For runs that want process isolation (per-worker memory limits, crash containment) instead of threads.
+// The coordinator maps one anonymous shared region, then forks N workers. Worker i enumerates the
+// contiguous key-index shard [i*total/N, (i+1)*total/N) with the same kernels as KeySearch (KeySpace,
+// ComponentSet, KeyBatchScorer). The engine is chosen in the coordinator before forking, so workers never
+// take the dispatcher's lock.
+//
+// Per-worker slot in shared memory:
+// - progress: next key index of the shard still to do, advanced after each batch;
+// - ring: single-producer/single-consumer ring of candidates. The worker pushes every candidate that enters
+//   its local top-K; the coordinator drains all rings into the global top-K. head/tail are lock-free atomics,
+//   which are address-free and therefore valid across processes.
+//
+// If a worker dies (signal, OOM kill, non-zero exit) the coordinator forks a replacement that resumes the shard
+// from `progress`. Keys of the interrupted batch may be reported twice; the coordinator drops duplicate keys.
+// A shard whose fork() fails is given up like one out of restarts: the run completes with complete = false.
+//
+// The coordinator waits for its own workers' pids only, so other children of an embedding program are left
+// for that program to reap. It is single-threaded, which keeps fork() safe. Everything stays on one machine.
+
+#pragma once
+
+#if defined(__linux__)
+
+#include "EnigmaSearch.h"
+#include "EnigmaTopK.h"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace EnigmaCore
+{
+	struct ShardSearchConfig
+	{
+		std::string ciphertext; // letters only are used
+		KeySpace space;
+		size_t topK{ 10 };
+		unsigned workers{ 4 };
+		unsigned maxRestartsPerWorker{ 3 };
+		uint64_t workerMemoryLimit{ 0 }; // bytes of address space per worker (RLIMIT_AS), 0 = unlimited
+	};
+
+	struct ShardSearchResult
+	{
+		bool complete{ false }; // false if a shard gave up after too many restarts or could not be forked
+		unsigned restarts{ 0 };
+		std::vector<SearchCandidate> candidates; // best first; plugboards are identity (enumeration only)
+	};
+
+	class ShardedKeySearch
+	{
+	public:
+		explicit ShardedKeySearch(const ShardSearchConfig& cfg)
+			: m_cfg(cfg)
+		{
+			for (char c : cfg.ciphertext)
+			{
+				int i = ch2i(c);
+				if (i != -1) m_text.push_back((uint8_t)i);
+			}
+			if (m_cfg.workers == 0) m_cfg.workers = 1;
+			if (m_cfg.topK == 0) m_cfg.topK = 1;
+		}
+
+		ShardSearchResult run()
+		{
+			ShardSearchResult res;
+			if (!mapShared()) return res;
+			m_engine = EngineDispatcher::instance().choose(kShapeManyKeys, m_text.size());
+
+			const uint64_t total = m_cfg.space.size();
+			std::vector<pid_t> pids(m_cfg.workers, -1);
+			std::vector<unsigned> restarts(m_cfg.workers, 0);
+			unsigned running = 0;
+			bool failed = false;
+			for (unsigned i = 0; i < m_cfg.workers; ++i)
+			{
+				Slot& s = slot(i);
+				s.begin = total * i / m_cfg.workers;
+				s.end = total * (i + 1) / m_cfg.workers;
+				s.progress.store(s.begin);
+				pids[i] = spawn(i);
+				if (pids[i] > 0) ++running;
+				else failed = true;
+			}
+
+			BoundedTopK<SearchCandidate> top(m_cfg.topK);
+			while (running > 0)
+			{
+				bool any = false;
+				for (unsigned i = 0; i < m_cfg.workers; ++i) any |= drain(slot(i), top);
+
+				for (unsigned i = 0; i < m_cfg.workers; ++i)
+				{
+					int status = 0;
+					if (pids[i] <= 0 || ::waitpid(pids[i], &status, WNOHANG) != pids[i]) continue;
+					any = true;
+					drain(slot(i), top);
+					Slot& s = slot(i);
+					bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && s.progress.load() >= s.end;
+					pids[i] = -1;
+					if (!ok && restarts[i] < m_cfg.maxRestartsPerWorker)
+					{
+						++restarts[i];
+						++res.restarts;
+						pids[i] = spawn(i);
+					}
+					if (pids[i] < 0)
+					{
+						failed |= !ok; // done, out of restarts, or the replacement could not be forked
+						--running;
+					}
+				}
+				if (!any) ::usleep(1000);
+			}
+
+			res.complete = !failed;
+			res.candidates = top.sorted();
+			unmapShared();
+			return res;
+		}
+
+	private:
+		static const size_t kRingSize = 1024; // power of two
+		static const uint64_t kBatch = 4096; // keys between progress updates
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "ShardedKeySearch needs lock-free 64-bit atomics for cross-process rings"
+#endif
+
+		struct Slot
+		{
+			uint64_t begin, end; // shard, written before fork
+			std::atomic<uint64_t> progress;
+			std::atomic<uint64_t> head; // written by the worker
+			std::atomic<uint64_t> tail; // written by the coordinator
+			SearchCandidate ring[kRingSize];
+		};
+
+		Slot& slot(unsigned i) { return reinterpret_cast<Slot*>(m_shared)[i]; }
+
+		// Anonymous and shared: only the forked workers inherit it, so concurrent runs in one process never meet,
+		// and nothing is left behind if we crash.
+		bool mapShared()
+		{
+			m_sharedSize = sizeof(Slot) * m_cfg.workers;
+			void* p = ::mmap(nullptr, m_sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+			if (p == MAP_FAILED) return false;
+			m_shared = p;
+			for (unsigned i = 0; i < m_cfg.workers; ++i)
+			{
+				Slot* s = &slot(i);
+				new (&s->progress) std::atomic<uint64_t>(0);
+				new (&s->head) std::atomic<uint64_t>(0);
+				new (&s->tail) std::atomic<uint64_t>(0);
+			}
+			return true;
+		}
+
+		void unmapShared()
+		{
+			if (m_shared) ::munmap(m_shared, m_sharedSize);
+			m_shared = nullptr;
+		}
+
+		// Drain one ring into the global top-K. Returns true if anything was read.
+		bool drain(Slot& s, BoundedTopK<SearchCandidate>& top)
+		{
+			uint64_t tail = s.tail.load(std::memory_order_relaxed);
+			uint64_t head = s.head.load(std::memory_order_acquire);
+			if (tail == head) return false;
+			for (; tail != head; ++tail)
+			{
+				const SearchCandidate& c = s.ring[tail % kRingSize];
+				bool dup = false;
+				for (const SearchCandidate& t : top.items()) dup |= (t.key == c.key);
+				if (!dup) top.offer(c);
+			}
+			s.tail.store(tail, std::memory_order_release);
+			return true;
+		}
+
+		// Returns the worker's pid, or -1 if fork() failed.
+		pid_t spawn(unsigned i)
+		{
+			pid_t pid = ::fork();
+			if (pid == 0)
+			{
+				if (m_cfg.workerMemoryLimit)
+				{
+					struct rlimit rl;
+					rl.rlim_cur = rl.rlim_max = (rlim_t)m_cfg.workerMemoryLimit;
+					::setrlimit(RLIMIT_AS, &rl);
+				}
+				workerMain(slot(i));
+				::_exit(0);
+			}
+			return pid;
+		}
+
+		void workerMain(Slot& s)
+		{
+			ComponentSet components;
+			KeyBatchScorer scorer(m_text, m_engine);
+			BoundedTopK<SearchCandidate> local(m_cfg.topK);
+			uint64_t k = s.progress.load();
+			while (k < s.end)
+			{
+				uint64_t end = (std::min)(s.end, k + kBatch);
+				scorer.score(m_cfg.space, components, k, end,
+					[&](const SearchCandidate& c) { if (local.offer(c)) push(s, c); });
+				k = end;
+				s.progress.store(k, std::memory_order_release);
+			}
+		}
+
+		// Producer side of the ring; waits for the coordinator if the ring is full.
+		static void push(Slot& s, const SearchCandidate& c)
+		{
+			uint64_t head = s.head.load(std::memory_order_relaxed);
+			while (head - s.tail.load(std::memory_order_acquire) >= kRingSize) ::usleep(100);
+			s.ring[head % kRingSize] = c;
+			s.head.store(head + 1, std::memory_order_release);
+		}
+
+		ShardSearchConfig m_cfg;
+		std::vector<uint8_t> m_text;
+		EngineKind m_engine{ kEngineTable };
+		void* m_shared{ nullptr };
+		size_t m_sharedSize{ 0 };
+	};
+}
+
+#endif // __linux__
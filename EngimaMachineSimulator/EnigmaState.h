@@ -0,0 +1,218 @@
+// EnigmaState.h - Fixed-size binary snapshot of an EnigmaMachine (C++14)
+//
+// A snapshot records the full machine state by component id, so it can be restored without re-stepping:
+// reflector, rotor order, rings, current positions and the plugboard permutation, plus the Greek wheel of an M4.
+// Only machines built from the standard factories (RotorByIndex/ReflectorByIndex) with the A..Z entry wheel can
+// be captured; custom wirings have no id. Three-rotor machines use reflector B or C and rotors I-VIII; an M4
+// (EnigmaMachineM4) uses thin B or C, Beta or Gamma, and rotors I-VIII behind it. LoadState builds the former,
+// LoadStateM4 the latter; IsM4State tells them apart.
+//
+// Encoded record (48 bytes, little-endian):
+//   [0..3]   magic "ENGS"
+//   [4..5]   format version (kMachineStateVersion)
+//   [6]      reflector id
+//   [7..9]   rotor ids (left, middle, right)
+//   [10..12] ring settings
+//   [13..15] rotor positions
+//   [16..41] plugboard permutation
+//   [42]     version 2: Greek wheel in bits 5-6 (0 = none, 1 = Beta, 2 = Gamma), its ring in bits 0-4; else zero
+//   [43]     version 2: Greek wheel position; else zero
+//   [44..47] FNV-1a checksum of bytes 0..43
+//
+// Readers accept any version up to their own; newer records are rejected rather than misread. Three-rotor
+// states are still written as version 1, so older readers keep reading them.
+
+#pragma once
+
+#include "Enigma.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace EnigmaCore
+{
+	const size_t kMachineStateSize = 48;
+	const uint16_t kMachineStateVersion = 2; // 2: Greek wheel (M4)
+
+	// A default-constructed state is a valid key: reflector B, rotors I-II-III, rings and positions at A, and
+	// nothing plugged (the identity permutation).
+	struct MachineState
+	{
+		uint8_t reflector{ 0 };
+		uint8_t rotors[3]{ 0, 1, 2 }; // left, middle, right
+		uint8_t rings[3]{};
+		uint8_t positions[3]{};
+		uint8_t plug[26]{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25 };
+		uint8_t greek{ 0 }; // M4 Greek wheel: rotor id 8 (Beta) or 9 (Gamma); 0 for a three-rotor machine
+		uint8_t greekRing{ 0 };
+		uint8_t greekPosition{ 0 };
+	};
+
+	inline bool IsM4State(const MachineState& s) { return s.greek != 0; }
+
+	inline uint32_t StateChecksum(const uint8_t* p, size_t n)
+	{
+		uint32_t h = 2166136261u;
+		for (size_t i = 0; i < n; ++i)
+		{
+			h ^= p[i];
+			h *= 16777619u;
+		}
+		return h;
+	}
+
+	namespace StateDetail
+	{
+		// Reflector, stepping rotors and plugboard, shared by the three-rotor machine and the M4.
+		template <class Machine>
+		bool Save(const Machine& em, int firstReflector, MachineState& st)
+		{
+			const Rotor* rotors[3] = { &em.leftRotor(), &em.middleRotor(), &em.rightRotor() };
+			const int reflector = em.reflector().id() - firstReflector;
+			if (reflector < 0 || reflector > 1 || em.entryWheel().id() != 0) return false;
+			MachineState s;
+			s.reflector = (uint8_t)em.reflector().id();
+			for (int i = 0; i < 3; ++i)
+			{
+				if (rotors[i]->id() < 0 || rotors[i]->id() > 7) return false;
+				s.rotors[i] = (uint8_t)rotors[i]->id();
+				s.rings[i] = (uint8_t)rotors[i]->ring();
+				s.positions[i] = (uint8_t)rotors[i]->position();
+			}
+			for (int i = 0; i < 26; ++i) s.plug[i] = (uint8_t)em.plugboard().map(i);
+			st = s;
+			return true;
+		}
+
+		template <class Machine>
+		void Load(const MachineState& st, Machine& em)
+		{
+			Rotor r[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				r[i] = RotorByIndex(st.rotors[i]);
+				r[i].setRing(st.rings[i]);
+				r[i].setPosition(st.positions[i]);
+			}
+			Plugboard plug;
+			for (int i = 0; i < 26; ++i)
+			{
+				if (st.plug[i] > i) plug.connect(i, st.plug[i]);
+			}
+			em.setReflector(ReflectorByIndex(st.reflector));
+			em.setRotors(r[0], r[1], r[2]);
+			em.setPlugboard(plug);
+		}
+	}
+
+	// Capture the machine's state. Returns false if it uses components without a standard id.
+	inline bool SaveState(const EnigmaMachine& em, MachineState& st)
+	{
+		return StateDetail::Save(em, 0, st);
+	}
+
+	// The same for an M4: thin reflector and Greek wheel included.
+	inline bool SaveState(const EnigmaMachineM4& em, MachineState& st)
+	{
+		const Rotor& greek = em.rotor(0);
+		if (greek.id() != 8 && greek.id() != 9) return false;
+		MachineState s;
+		if (!StateDetail::Save(em, 2, s)) return false;
+		s.greek = (uint8_t)greek.id();
+		s.greekRing = (uint8_t)greek.ring();
+		s.greekPosition = (uint8_t)greek.position();
+		st = s;
+		return true;
+	}
+
+	// Rebuild a three-rotor machine from a snapshot; it continues exactly where the captured one was.
+	inline EnigmaMachine LoadState(const MachineState& st)
+	{
+		EnigmaMachine em;
+		StateDetail::Load(st, em);
+		return em;
+	}
+
+	// Rebuild an M4 from a snapshot with a Greek wheel (IsM4State).
+	inline EnigmaMachineM4 LoadStateM4(const MachineState& st)
+	{
+		EnigmaMachineM4 em;
+		StateDetail::Load(st, em);
+		Rotor greek = RotorByIndex(st.greek);
+		greek.setRing(st.greekRing);
+		greek.setPosition(st.greekPosition);
+		em.setRotor(0, greek);
+		return em;
+	}
+
+	// Ids and letters in range, and a plugboard that is a set of swaps: LoadState (or LoadStateM4) can build it.
+	inline bool IsValidState(const MachineState& s)
+	{
+		if (s.greek == 0)
+		{
+			if (s.reflector > 1 || s.greekRing != 0 || s.greekPosition != 0) return false;
+		}
+		else if (s.greek < 8 || s.greek > 9 || s.reflector < 2 || s.reflector > 3 || s.greekRing > 25 || s.greekPosition > 25)
+		{
+			return false;
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			if (s.rotors[i] > 7 || s.rings[i] > 25 || s.positions[i] > 25) return false;
+		}
+		for (int i = 0; i < 26; ++i)
+		{
+			if (s.plug[i] > 25 || s.plug[s.plug[i]] != i) return false;
+		}
+		return true;
+	}
+
+	inline void EncodeState(const MachineState& st, uint8_t out[kMachineStateSize])
+	{
+		std::memset(out, 0, kMachineStateSize);
+		std::memcpy(out, "ENGS", 4);
+		const uint16_t version = IsM4State(st) ? 2 : 1;
+		out[4] = (uint8_t)(version & 0xFF);
+		out[5] = (uint8_t)(version >> 8);
+		out[6] = st.reflector;
+		std::memcpy(out + 7, st.rotors, 3);
+		std::memcpy(out + 10, st.rings, 3);
+		std::memcpy(out + 13, st.positions, 3);
+		std::memcpy(out + 16, st.plug, 26);
+		if (IsM4State(st))
+		{
+			out[42] = (uint8_t)(((st.greek - 7) << 5) | st.greekRing);
+			out[43] = st.greekPosition;
+		}
+		uint32_t h = StateChecksum(out, 44);
+		for (int i = 0; i < 4; ++i) out[44 + i] = (uint8_t)(h >> (8 * i));
+	}
+
+	// Decode and validate a record. Returns false on bad magic, unknown version, checksum mismatch,
+	// non-zero bytes 42-43 in a version 1 record, or a state that fails IsValidState.
+	inline bool DecodeState(const uint8_t in[kMachineStateSize], MachineState& st)
+	{
+		if (std::memcmp(in, "ENGS", 4) != 0) return false;
+		uint16_t version = (uint16_t)(in[4] | (in[5] << 8));
+		if (version == 0 || version > kMachineStateVersion) return false;
+		uint32_t h = 0;
+		for (int i = 0; i < 4; ++i) h |= (uint32_t)in[44 + i] << (8 * i);
+		if (h != StateChecksum(in, 44)) return false;
+		if (version == 1 && (in[42] != 0 || in[43] != 0)) return false;
+		if (in[42] & 0x80) return false;
+
+		MachineState s;
+		s.reflector = in[6];
+		std::memcpy(s.rotors, in + 7, 3);
+		std::memcpy(s.rings, in + 10, 3);
+		std::memcpy(s.positions, in + 13, 3);
+		std::memcpy(s.plug, in + 16, 26);
+		const int greek = in[42] >> 5;
+		s.greek = (uint8_t)(greek ? 7 + greek : 0);
+		s.greekRing = (uint8_t)(in[42] & 31);
+		s.greekPosition = in[43];
+		if (!IsValidState(s)) return false;
+		st = s;
+		return true;
+	}
+}
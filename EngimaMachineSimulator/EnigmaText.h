@@ -0,0 +1,183 @@
+// EnigmaText.h - Piece-table text model and edit deltas (C++14)
+//
+// A PieceTable holds a text as a list of pieces. Each piece is a range of one of two buffers: the text the table
+// was created with, which never changes, and an append-only buffer of everything inserted since. An edit splits
+// at most two pieces and appends the inserted characters. It never copies the text, and memory grows with what
+// was typed rather than with the size of the text. Typing on at the end of the last insertion extends its piece
+// instead of adding one.
+//
+// Edits are TextPatches: replace `removed` characters at `offset` by `inserted`. diff() gives the patch that turns
+// the table into another text (common prefix and suffix). It compares piece by piece, so a caller holding the new
+// text in its own buffer (an edit control, say) finds the change without building either string.
+//
+// Pieces are found by walking the list: interactively edited text has few pieces for its length. compact() puts
+// the text back into one piece when the list has grown.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace EnigmaCore
+{
+	// Replace `removed` characters at `offset` by `inserted`.
+	template <class CharT>
+	struct BasicTextPatch
+	{
+		typedef std::basic_string<CharT> String;
+
+		size_t offset{ 0 };
+		size_t removed{ 0 };
+		String inserted;
+
+		bool empty() const { return removed == 0 && inserted.empty(); }
+		void applyTo(String& text) const { text.replace(offset, removed, inserted); }
+	};
+
+	typedef BasicTextPatch<char> TextPatch;
+
+	template <class CharT>
+	class BasicPieceTable
+	{
+	public:
+		typedef std::basic_string<CharT> String;
+		typedef BasicTextPatch<CharT> Patch;
+
+		BasicPieceTable() {}
+		explicit BasicPieceTable(String text) : m_original(std::move(text)), m_size(m_original.size())
+		{
+			if (m_size) m_pieces.push_back(Piece{ false, 0, m_size });
+		}
+
+		void assign(String text) { *this = BasicPieceTable(std::move(text)); }
+		void clear() { assign(String()); }
+		void compact() { assign(str()); }
+
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+		size_t pieceCount() const { return m_pieces.size(); }
+
+		// Replace `removed` characters at `offset` by s[0, n). Offset and count are clamped to the text.
+		void replace(size_t offset, size_t removed, const CharT* s, size_t n)
+		{
+			offset = (std::min)(offset, m_size);
+			removed = (std::min)(removed, m_size - offset);
+			const size_t first = split(offset);
+			const size_t last = split(offset + removed);
+			m_pieces.erase(m_pieces.begin() + first, m_pieces.begin() + last);
+			m_size -= removed;
+			if (n == 0) return;
+			if (first > 0 && m_pieces[first - 1].added && m_pieces[first - 1].start + m_pieces[first - 1].length == m_added.size())
+				m_pieces[first - 1].length += n;
+			else
+				m_pieces.insert(m_pieces.begin() + first, Piece{ true, m_added.size(), n });
+			m_added.append(s, n);
+			m_size += n;
+		}
+		void apply(const Patch& patch) { replace(patch.offset, patch.removed, patch.inserted.data(), patch.inserted.size()); }
+
+		// Call f(const CharT* p, size_t n) for the text in [from, to), one run per piece, in order.
+		template <class F>
+		void forEach(size_t from, size_t to, F f) const
+		{
+			size_t pos = 0;
+			for (const Piece& piece : m_pieces)
+			{
+				if (pos >= to) break;
+				const size_t end = pos + piece.length;
+				if (end > from)
+				{
+					const size_t a = (std::max)(from, pos) - pos, b = (std::min)(to, end) - pos;
+					f(data(piece) + a, b - a);
+				}
+				pos = end;
+			}
+		}
+
+		String substr(size_t from, size_t n) const
+		{
+			String s;
+			from = (std::min)(from, m_size);
+			n = (std::min)(n, m_size - from);
+			s.reserve(n);
+			forEach(from, from + n, [&](const CharT* p, size_t k) { s.append(p, k); });
+			return s;
+		}
+		String str() const { return substr(0, m_size); }
+
+		// The patch that turns this text into text[0, n).
+		Patch diff(const CharT* text, size_t n) const
+		{
+			const size_t limit = (std::min)(m_size, n);
+			size_t prefix = 0;
+			for (const Piece& piece : m_pieces)
+			{
+				const CharT* p = data(piece);
+				const size_t len = (std::min)(piece.length, limit - prefix);
+				size_t k = 0;
+				while (k < len && p[k] == text[prefix + k]) ++k;
+				prefix += k;
+				if (k < piece.length) break;
+			}
+			const size_t maxSuffix = limit - prefix;
+			size_t suffix = 0;
+			for (size_t i = m_pieces.size(); i > 0 && suffix < maxSuffix; --i)
+			{
+				const Piece& piece = m_pieces[i - 1];
+				const CharT* p = data(piece) + piece.length;
+				const size_t len = (std::min)(piece.length, maxSuffix - suffix);
+				size_t k = 0;
+				while (k < len && p[-1 - (ptrdiff_t)k] == text[n - 1 - suffix - k]) ++k;
+				suffix += k;
+				if (k < piece.length) break;
+			}
+			Patch patch;
+			patch.offset = prefix;
+			patch.removed = m_size - suffix - prefix;
+			patch.inserted.assign(text + prefix, n - suffix - prefix);
+			return patch;
+		}
+		Patch diff(const String& text) const { return diff(text.data(), text.size()); }
+
+	private:
+		struct Piece
+		{
+			bool added; // in m_added, else in m_original
+			size_t start;
+			size_t length;
+		};
+
+		const CharT* data(const Piece& piece) const { return (piece.added ? m_added.data() : m_original.data()) + piece.start; }
+
+		// Index of the piece that starts at pos, splitting the piece that contains it if needed
+		size_t split(size_t pos)
+		{
+			size_t start = 0;
+			for (size_t i = 0; i < m_pieces.size(); ++i)
+			{
+				if (start == pos) return i;
+				const size_t length = m_pieces[i].length;
+				if (pos < start + length)
+				{
+					Piece tail = m_pieces[i];
+					tail.start += pos - start;
+					tail.length -= pos - start;
+					m_pieces[i].length = pos - start;
+					m_pieces.insert(m_pieces.begin() + (ptrdiff_t)i + 1, tail);
+					return i + 1;
+				}
+				start += length;
+			}
+			return m_pieces.size();
+		}
+
+		String m_original;
+		String m_added;
+		std::vector<Piece> m_pieces;
+		size_t m_size{ 0 };
+	};
+
+	typedef BasicPieceTable<char> PieceTable;
+}
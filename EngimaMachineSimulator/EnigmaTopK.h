@@ -0,0 +1,140 @@
+// EnigmaTopK.h - Bounded and concurrent top-K candidate collectors (C++14)
+//
+// Candidate types need an unsigned integer `score` member and a strict total order
+// `bool betterThan(const Candidate&) const` (higher score first, ties broken by something unique such as
+// the key index). Because the order is total, the merged result is the same however the candidates were
+// distributed over threads.
+//
+// ConcurrentTopK gives every worker its own bounded heap and shares only a cutoff score. Once a worker's heap
+// is full, its worst score is a lower bound for the global K-th best, so it publishes it with a CAS-max.
+// Workers then reject anything below the cutoff with a single relaxed load and never take a lock; candidates
+// that equal the cutoff are still offered, since the tie-break may put them in the result.
+
+#pragma once
+
+#include "EnigmaAlign.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace EnigmaCore
+{
+	// Keeps the k best candidates seen (min-heap on betterThan, worst at the front).
+	template <class Candidate>
+	class BoundedTopK
+	{
+	public:
+		explicit BoundedTopK(size_t k = 1) : m_k(k) {}
+
+		// Returns true if the candidate was kept.
+		bool offer(const Candidate& c)
+		{
+			if (m_heap.size() < m_k)
+			{
+				m_heap.push_back(c);
+				std::push_heap(m_heap.begin(), m_heap.end(), better);
+				return true;
+			}
+			if (!c.betterThan(m_heap.front())) return false;
+			std::pop_heap(m_heap.begin(), m_heap.end(), better);
+			m_heap.back() = c;
+			std::push_heap(m_heap.begin(), m_heap.end(), better);
+			return true;
+		}
+
+		// Restore heap order after the candidates were replaced wholesale.
+		void assign(const std::vector<Candidate>& cands)
+		{
+			m_heap = cands;
+			std::make_heap(m_heap.begin(), m_heap.end(), better);
+		}
+
+		bool full() const { return m_heap.size() >= m_k; }
+		const Candidate& worst() const { return m_heap.front(); }
+		size_t capacity() const { return m_k; }
+
+		const std::vector<Candidate>& items() const { return m_heap; }
+		std::vector<Candidate>& items() { return m_heap; }
+		void clear() { m_heap.clear(); }
+
+		// Candidates best first.
+		std::vector<Candidate> sorted() const
+		{
+			std::vector<Candidate> out(m_heap);
+			std::sort(out.begin(), out.end(), better);
+			return out;
+		}
+
+	private:
+		// Best first for std::sort; as the heap's less-than it keeps the worst candidate at the front.
+		static bool better(const Candidate& a, const Candidate& b) { return a.betterThan(b); }
+
+		size_t m_k;
+		std::vector<Candidate> m_heap;
+	};
+
+	// Per-worker bounded heaps with a lock-free shared cutoff. Slot i must only be used by one thread at a time.
+	template <class Candidate>
+	class ConcurrentTopK
+	{
+	public:
+		ConcurrentTopK(size_t k, unsigned slots)
+			: m_k(k)
+		{
+			for (unsigned i = 0; i < slots; ++i) m_slots.emplace_back(new Slot(k));
+		}
+
+		// Fast pre-check before building a full candidate: false if the score cannot make the top K.
+		bool admits(uint64_t score) const { return score >= m_cutoff.load(std::memory_order_relaxed); }
+
+		void offer(unsigned slot, const Candidate& c)
+		{
+			if (!admits(c.score)) return;
+			BoundedTopK<Candidate>& heap = m_slots[slot]->heap;
+			if (heap.offer(c) && heap.full()) raiseCutoff(heap.worst().score);
+		}
+
+		uint64_t cutoff() const { return m_cutoff.load(std::memory_order_relaxed); }
+
+		// Lift the cutoff to a known lower bound for the K-th best score (e.g. from a resumed result).
+		void raiseCutoff(uint64_t score)
+		{
+			uint64_t cur = m_cutoff.load(std::memory_order_relaxed);
+			while (score > cur && !m_cutoff.compare_exchange_weak(cur, score, std::memory_order_relaxed)) {}
+		}
+
+		// Merge all slots into the global top K, best first. Call only while no worker is offering.
+		std::vector<Candidate> result() const
+		{
+			BoundedTopK<Candidate> merged(m_k);
+			for (const auto& s : m_slots)
+			{
+				for (const Candidate& c : s->heap.items()) merged.offer(c);
+			}
+			return merged.sorted();
+		}
+
+		// Drop everything and reset the cutoff. Call only while no worker is offering.
+		void clear()
+		{
+			for (auto& s : m_slots) s->heap.clear();
+			m_cutoff.store(0);
+		}
+
+	private:
+		// Whole cache lines each, so updating one worker's heap header (size, end pointer) does not invalidate
+		// another's; the candidates are in the vector's own allocation.
+		struct alignas(kCacheLineSize) Slot : CacheLineAllocated
+		{
+			explicit Slot(size_t k) : heap(k) {}
+			BoundedTopK<Candidate> heap;
+		};
+
+		size_t m_k;
+		std::vector<std::unique_ptr<Slot>> m_slots;
+		std::atomic<uint64_t> m_cutoff{ 0 };
+	};
+}
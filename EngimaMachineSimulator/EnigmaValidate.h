@@ -0,0 +1,554 @@
+// EnigmaValidate.h - Differential validation of optimized engines against EnigmaMachine (C++14)
+//
+// Every case is a random key (MachineState) and a random text; each engine under test must return exactly
+// what EnigmaMachine::encrypt returns for it, byte for byte. Cases are derived from (seed, case index) alone,
+// so any failure can be replayed from those two numbers.
+//
+// Case generation leans towards the places where engines tend to diverge:
+// - start positions near the right/middle notches, so turnovers and double steps happen early;
+// - non-zero rings, which shift where the notch is seen (Rotor::atNotch);
+// - 0..13 plugboard pairs; mixed case, digits, punctuation and bytes >= 0x80 in the text;
+// - a share of long texts (several left-rotor steps).
+//
+// A mismatch is minimized before it is reported:
+// 1. cut the text after the first wrong output byte (output i only depends on the prefix);
+// 2. drop characters that are not letters (they do not move the rotors);
+// 3. start the key later: replace the first j letters by the reference machine's positions after them,
+//    trying the largest j first (ideally a single letter remains);
+// 4. remove plugboard pairs one at a time, then try ring A and reflector B, keeping every change that
+//    still fails.
+//
+// The run is spread over WorkStealingScheduler workers in epochs until the letter budget or time limit is
+// reached; engines are plain callables, so new engines only need an adapter.
+
+#pragma once
+
+#include "Enigma.h"
+#include "EnigmaDispatch.h"
+#include "EnigmaEngines.h"
+#include "EnigmaProbe.h"
+#include "EnigmaScheduler.h"
+#include "EnigmaSession.h"
+#include "EnigmaWorker.h"
+#include "EnigmaState.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace EnigmaCore
+{
+	// An engine under test: encrypt `text` with a machine in state `key` from the start.
+	struct ValidationEngine
+	{
+		std::string name;
+		std::function<std::string(const MachineState& key, const std::string& text)> encrypt;
+	};
+
+	struct Counterexample
+	{
+		std::string engine;
+		uint64_t caseIndex{ 0 };
+		MachineState key{};
+		std::string text; // minimized
+		std::string expected; // reference output
+		std::string actual;
+
+		// One line: engine, case, key in keysheet notation, and the failing text.
+		std::string describe() const
+		{
+			char buf[256];
+			std::string plug;
+			for (int i = 0; i < 26; ++i)
+			{
+				if (key.plug[i] > i)
+				{
+					if (!plug.empty()) plug += ' ';
+					plug += (char)('A' + i);
+					plug += (char)('A' + key.plug[i]);
+				}
+			}
+			static const char* const rotorNames[8] = { "I", "II", "III", "IV", "V", "VI", "VII", "VIII" };
+			auto rotor = [&](int i) { return key.rotors[i] < 8 ? rotorNames[key.rotors[i]] : "?"; };
+			std::snprintf(buf, sizeof(buf), "%s case %llu: UKW-%c %s-%s-%s rings %c%c%c start %c%c%c plug [%s]",
+				engine.c_str(), (unsigned long long)caseIndex, key.reflector == 1 ? 'C' : 'B', rotor(0), rotor(1), rotor(2),
+				'A' + key.rings[0], 'A' + key.rings[1], 'A' + key.rings[2],
+				'A' + key.positions[0], 'A' + key.positions[1], 'A' + key.positions[2], plug.c_str());
+			return std::string(buf) + " text \"" + printable(text) + "\" expected \"" + printable(expected) +
+				"\" got \"" + printable(actual) + "\"";
+		}
+
+	private:
+		static std::string printable(const std::string& s)
+		{
+			std::string out;
+			char hex[8];
+			for (char c : s)
+			{
+				unsigned char u = (unsigned char)c;
+				if (u >= 0x20 && u < 0x7f && c != '"' && c != '\\') out += c;
+				else { std::snprintf(hex, sizeof(hex), "\\x%02x", u); out += hex; }
+			}
+			return out;
+		}
+	};
+
+	struct ValidationConfig
+	{
+		uint64_t seed{ 1 };
+		uint64_t letters{ 100000000 }; // stop after checking at least this many text bytes per engine
+		double seconds{ 0.0 }; // stop after this long (0 = no limit)
+		size_t maxTextLength{ 2048 };
+		size_t maxCounterexamples{ 10 }; // stop once this many were found
+		unsigned threads{ 0 }; // 0 = all hardware threads
+		std::vector<ValidationEngine> engines;
+		std::function<void(uint64_t cases, uint64_t letters)> progress; // after every epoch, on the calling thread
+	};
+
+	struct ValidationReport
+	{
+		uint64_t cases{ 0 };
+		uint64_t letters{ 0 }; // text bytes per engine
+		std::vector<uint64_t> mismatches; // per engine, cases before minimization
+		std::vector<Counterexample> counterexamples;
+
+		bool passed() const { return counterexamples.empty(); }
+	};
+
+	// Engines this build can check: TableEngine, EngineDispatcher stream, the AVX2 batch engine when the CPU has
+	// AVX2 (the key runs in a rotating lane next to seven other keys), the machine with a CountingProbe, a
+	// TypingSession that keeps typing and taking back detours (so every unstep must be exact), and an
+	// IncrementalSession with a tiny checkpoint interval that reaches the text through piece-table deltas in the
+	// middle and a change of key, its output assembled from the patches alone, an EncryptionWorker whose
+	// chunks are collected by a fake consumer after a replaced decoy job, and the machine and an IncrementalSession
+	// on UTF-16 and UTF-32 text with non-ASCII characters in between.
+	inline std::vector<ValidationEngine> DefaultValidationEngines()
+	{
+		std::vector<ValidationEngine> engines;
+
+		ValidationEngine table;
+		table.name = "table";
+		table.encrypt = [](const MachineState& key, const std::string& text)
+		{
+			EnigmaMachine em = LoadState(key);
+			return TableEngine(em).encrypt(text);
+		};
+		engines.push_back(table);
+
+		ValidationEngine dispatch;
+		dispatch.name = "dispatch";
+		dispatch.encrypt = [](const MachineState& key, const std::string& text)
+		{
+			EnigmaMachine em = LoadState(key);
+			return EngineDispatcher::instance().encrypt(em, text);
+		};
+		engines.push_back(dispatch);
+
+		if (EngineDispatcher::instance().supports(kEngineAvx2Batch))
+		{
+			ValidationEngine batch;
+			batch.name = "avx2Batch";
+			batch.encrypt = [](const MachineState& key, const std::string& text)
+			{
+				std::vector<uint8_t> letters;
+				for (char c : text)
+				{
+					int i = ch2i(c);
+					if (i != -1) letters.push_back((uint8_t)i);
+				}
+				const size_t lanes = 8, lane = text.size() % lanes;
+				std::vector<EnigmaMachine> machines;
+				for (size_t l = 0; l < lanes; ++l)
+				{
+					MachineState other = key;
+					for (int r = 0; r < 3; ++r) other.positions[r] = (uint8_t)((key.positions[r] + 7 * l + r) % 26);
+					other.rotors[0] = (uint8_t)((key.rotors[0] + l) % 8);
+					if (other.rotors[0] == key.rotors[1] || other.rotors[0] == key.rotors[2]) other.rotors[0] = key.rotors[0];
+					machines.push_back(LoadState(l == lane ? key : other));
+				}
+				std::vector<uint8_t> out(lanes * letters.size());
+				EngineDispatcher::runManyKeys(kEngineAvx2Batch, machines.data(), lanes, letters.data(), letters.size(), out.data());
+				std::string result(text);
+				size_t k = 0;
+				for (char& c : result)
+				{
+					if (ch2i(c) != -1) c = (char)('A' + out[lane * letters.size() + k++]);
+				}
+				return result;
+			};
+			engines.push_back(batch);
+		}
+
+		ValidationEngine probe;
+		probe.name = "countingProbe";
+		probe.encrypt = [](const MachineState& key, const std::string& text)
+		{
+			EnigmaMachine ref = LoadState(key);
+			BasicEnigmaMachine<CountingProbe> em;
+			em.setRotors(ref.leftRotor(), ref.middleRotor(), ref.rightRotor());
+			em.setReflector(ref.reflector());
+			em.setPlugboard(ref.plugboard());
+			return em.encrypt(text);
+		};
+		engines.push_back(probe);
+
+		ValidationEngine session;
+		session.name = "typingSession";
+		session.encrypt = [](const MachineState& key, const std::string& text)
+		{
+			TypingSession s(LoadState(key));
+			for (size_t i = 0; i < text.size(); ++i)
+			{
+				s.type(text[i]);
+				// 0..4 wrong letters, taken back one by one
+				const size_t detour = (i * 7 + text.size()) % 5;
+				for (size_t k = 0; k < detour; ++k) s.type((char)('A' + (i + k) % 26));
+				s.backspace(detour);
+				// now and then a longer tail is deleted and typed again
+				if (i % 61 == 60)
+				{
+					s.backspace(40);
+					s.setText(text.substr(0, i + 1));
+				}
+			}
+			return s.ciphertext();
+		};
+		engines.push_back(session);
+
+		ValidationEngine incremental;
+		incremental.name = "incremental";
+		incremental.encrypt = [](const MachineState& key, const std::string& text)
+		{
+			// The edits reach the session as deltas of a piece table, and the first is typed under another key
+			IncrementalSession s(EnigmaMachine(), 5);
+			PieceTable doc;
+			std::string shown;
+			auto edit = [&](const std::string& t)
+			{
+				const TextPatch delta = doc.diff(t);
+				doc.apply(delta);
+				s.apply(delta).applyTo(shown);
+			};
+			const size_t n = text.size(), a = n / 3, b = 2 * n / 3, c = 3 * n / 4;
+			edit(text.substr(0, b));
+			s.setKey(LoadState(key));
+			shown = s.ciphertext();
+			// insert letters in the middle: everything after them moves
+			edit(text.substr(0, a) + "XYZ" + text.substr(a, b - a));
+			// all but the character at c, with letters overtyped and punctuation added before it
+			std::string gap = text;
+			if (c < n) gap.erase(c, 1);
+			std::string t = gap;
+			for (size_t i = a; i < a + 4 && i < t.size(); ++i)
+			{
+				if (ch2i(t[i]) >= 0) t[i] = (char)('A' + (ch2i(t[i]) + 1) % 26);
+			}
+			t.insert(a / 2, ", ");
+			edit(t);
+			// back to gap: same letter count, so only that range is encrypted and the later checkpoints move
+			edit(gap);
+			// the last edit starts from one of the moved checkpoints
+			edit(text);
+			return shown;
+		};
+		engines.push_back(incremental);
+
+		ValidationEngine worker;
+		worker.name = "worker";
+		worker.encrypt = [](const MachineState& key, const std::string& text)
+		{
+			// A fake consumer: collects the chunks of the job it last submitted, in order, after a decoy job
+			// under another key that is replaced at once (it may have delivered chunks of its own by then)
+			std::mutex mutex;
+			uint64_t wanted = 0;
+			std::string shown, sessionCipher;
+			bool done = false;
+			EncryptionWorker w(
+				[&](const EncryptionChunk& c)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (c.job != wanted) return;
+					if (c.offset != shown.size() || c.total != text.size()) shown += '!';
+					shown += c.text;
+				},
+				[&](uint64_t job, EncryptionWorker::Session& s)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (job != wanted) return;
+					sessionCipher = s.ciphertext();
+					done = true;
+				},
+				3);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				EnigmaMachine decoy = LoadState(key);
+				decoy.step();
+				wanted = w.submit(decoy, text + text);
+				wanted = w.submit(LoadState(key), text);
+			}
+			w.wait();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!done || sessionCipher != shown) shown += '!';
+			return shown;
+		};
+		engines.push_back(worker);
+
+		ValidationEngine wide;
+		wide.name = "wide";
+		wide.encrypt = [](const MachineState& key, const std::string& text)
+		{
+			// The text as UTF-16 and UTF-32 (each byte one unit), with a character after every fifth whose low byte
+			// is a letter: it must pass through without stepping. UTF-16 goes through encrypt, UTF-32 through
+			// an IncrementalSession.
+			std::u16string u16;
+			std::u32string u32;
+			for (size_t i = 0; i < text.size(); ++i)
+			{
+				const unsigned char u = (unsigned char)text[i];
+				u16.push_back((char16_t)u);
+				u32.push_back((char32_t)u);
+				if (i % 5 == 4)
+				{
+					u16.push_back((char16_t)(0x100 + 'A' + i % 26));
+					u32.push_back((char32_t)(0x10000 + 'a' + i % 26));
+				}
+			}
+			EnigmaMachine em = LoadState(key);
+			const std::u16string c16 = em.encrypt(u16);
+			BasicIncrementalSession<EnigmaMachine, char32_t> s(LoadState(key), 5);
+			s.setText(u32);
+			const std::u32string& c32 = s.ciphertext();
+
+			std::string out;
+			for (size_t i = 0, k = 0; i < text.size(); ++i, ++k)
+			{
+				if (c16[k] > 0xFF || c16[k] != c32[k]) out += '!';
+				out += (char)c16[k];
+				if (i % 5 == 4)
+				{
+					++k;
+					if (c16[k] != u16[k] || c32[k] != u32[k]) out += '!';
+				}
+			}
+			return out;
+		};
+		engines.push_back(wide);
+
+		return engines;
+	}
+
+	class DifferentialValidator
+	{
+	public:
+		explicit DifferentialValidator(const ValidationConfig& cfg) : m_cfg(cfg) {}
+
+		ValidationReport run()
+		{
+			ValidationReport report;
+			report.mismatches.assign(m_cfg.engines.size(), 0);
+			if (m_cfg.engines.empty()) return report;
+
+			WorkStealingScheduler scheduler(m_cfg.threads);
+			const unsigned nThreads = scheduler.threadCount();
+			const auto start = std::chrono::steady_clock::now();
+			std::atomic<uint64_t> letters{ 0 };
+			std::vector<std::vector<uint64_t>> mismatches(nThreads, std::vector<uint64_t>(m_cfg.engines.size(), 0));
+			std::vector<Counterexample> found;
+			std::mutex foundMutex;
+			std::atomic<bool> enough{ false };
+
+			WorkStealingScheduler::RangeBody body = [&](uint64_t b, uint64_t e, unsigned w)
+			{
+				uint64_t done = 0;
+				for (uint64_t c = b; c < e && !enough.load(std::memory_order_relaxed); ++c)
+				{
+					MachineState key;
+					std::string text;
+					makeCase(c, key, text);
+					done += text.size();
+					const std::string expected = reference(key, text);
+					for (size_t i = 0; i < m_cfg.engines.size(); ++i)
+					{
+						const ValidationEngine& engine = m_cfg.engines[i];
+						if (engine.encrypt(key, text) == expected) continue;
+						++mismatches[w][i];
+						Counterexample ce = minimize(engine, c, key, text);
+						std::lock_guard<std::mutex> lock(foundMutex);
+						found.push_back(ce);
+						if (found.size() >= m_cfg.maxCounterexamples) enough.store(true);
+					}
+				}
+				letters.fetch_add(done, std::memory_order_relaxed);
+			};
+
+			// Epochs of a fixed number of cases keep the result independent of timing, apart from where it stops.
+			const uint64_t epochCases = 256ull * nThreads;
+			uint64_t next = 0;
+			while (!enough.load() && letters.load() < m_cfg.letters)
+			{
+				scheduler.parallelFor(next, next + epochCases, 16, body);
+				next += epochCases;
+				if (m_cfg.progress) m_cfg.progress(next, letters.load());
+				double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				if (m_cfg.seconds > 0.0 && elapsed >= m_cfg.seconds) break;
+			}
+
+			report.cases = next;
+			report.letters = letters.load();
+			for (const auto& perWorker : mismatches)
+			{
+				for (size_t i = 0; i < perWorker.size(); ++i) report.mismatches[i] += perWorker[i];
+			}
+			std::sort(found.begin(), found.end(), [](const Counterexample& a, const Counterexample& b)
+			{
+				return a.caseIndex != b.caseIndex ? a.caseIndex < b.caseIndex : a.engine < b.engine;
+			});
+			report.counterexamples = found;
+			return report;
+		}
+
+		// Rebuild case `index` (for replaying a reported failure).
+		void makeCase(uint64_t index, MachineState& key, std::string& text) const
+		{
+			uint64_t state = m_cfg.seed * 0x9e3779b97f4a7c15ull + index;
+			auto next = [&]() -> uint64_t
+			{
+				// splitmix64
+				uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+				return z ^ (z >> 31);
+			};
+			auto below = [&](uint64_t n) { return (int)(next() % n); };
+
+			key.reflector = (uint8_t)below(2);
+			int avail[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+			for (int i = 0; i < 3; ++i)
+			{
+				int j = i + below(8 - i);
+				std::swap(avail[i], avail[j]);
+				key.rotors[i] = (uint8_t)avail[i];
+			}
+			static const int notches[8][2] = { { 16, 16 }, { 4, 4 }, { 21, 21 }, { 9, 9 }, { 25, 25 }, // Q E V J Z
+				{ 25, 12 }, { 25, 12 }, { 25, 12 } }; // Z+M
+			for (int i = 0; i < 3; ++i)
+			{
+				key.rings[i] = (uint8_t)(below(3) == 0 ? 0 : below(26));
+				// Half of the right/middle rotors start within a few steps of (one of) their notches.
+				int pos = below(26);
+				if (i > 0 && below(2) == 0) pos = notches[key.rotors[i]][below(2)] + key.rings[i] - below(3);
+				key.positions[i] = (uint8_t)mod26(pos);
+			}
+			for (int i = 0; i < 26; ++i) key.plug[i] = (uint8_t)i;
+			const int pairs = below(14);
+			for (int p = 0; p < pairs; ++p)
+			{
+				int a = below(26), b = below(26);
+				if (a != b && key.plug[a] == a && key.plug[b] == b)
+				{
+					key.plug[a] = (uint8_t)b;
+					key.plug[b] = (uint8_t)a;
+				}
+			}
+
+			size_t len = (size_t)below((uint64_t)m_cfg.maxTextLength + 1);
+			if (below(16) == 0) len = m_cfg.maxTextLength * (size_t)(2 + below(6)); // long tail
+			text.resize(len);
+			for (char& c : text)
+			{
+				int kind = below(32);
+				if (kind < 20) c = (char)('A' + below(26));
+				else if (kind < 28) c = (char)('a' + below(26));
+				else if (kind < 30) c = " .,\n0123456789"[below(14)];
+				else c = (char)(0x80 + below(128));
+			}
+		}
+
+	private:
+		static std::string reference(const MachineState& key, const std::string& text)
+		{
+			return LoadState(key).encrypt(text);
+		}
+
+		static bool fails(const ValidationEngine& engine, const MachineState& key, const std::string& text)
+		{
+			return engine.encrypt(key, text) != reference(key, text);
+		}
+
+		Counterexample minimize(const ValidationEngine& engine, uint64_t index, MachineState key, std::string text) const
+		{
+			// 1. Prefix up to the first wrong byte.
+			{
+				const std::string expected = reference(key, text), actual = engine.encrypt(key, text);
+				size_t n = 0;
+				while (n < expected.size() && n < actual.size() && expected[n] == actual[n]) ++n;
+				if (n < text.size() && fails(engine, key, text.substr(0, n + 1))) text.resize(n + 1);
+			}
+			// 2. Letters only.
+			{
+				std::string letters;
+				for (char c : text)
+				{
+					if (ch2i(c) != -1) letters += c;
+				}
+				if (!letters.empty() && letters != text && fails(engine, key, letters)) text = letters;
+			}
+			// 3. Start later: largest skip first.
+			for (size_t skip = text.size() > 0 ? text.size() - 1 : 0; skip > 0; skip /= 2)
+			{
+				EnigmaMachine em = LoadState(key);
+				em.encrypt(text.substr(0, skip));
+				MachineState later = key;
+				later.positions[0] = (uint8_t)em.leftPos();
+				later.positions[1] = (uint8_t)em.midPos();
+				later.positions[2] = (uint8_t)em.rightPos();
+				std::string rest = text.substr(skip);
+				if (fails(engine, later, rest))
+				{
+					key = later;
+					text = rest;
+					break;
+				}
+			}
+			// 4. Simpler key.
+			for (int i = 0; i < 26; ++i)
+			{
+				int j = key.plug[i];
+				if (j <= i) continue;
+				MachineState k = key;
+				k.plug[i] = (uint8_t)i;
+				k.plug[j] = (uint8_t)j;
+				if (fails(engine, k, text)) key = k;
+			}
+			for (int r = 0; r < 3; ++r)
+			{
+				MachineState k = key;
+				k.rings[r] = 0;
+				if (key.rings[r] != 0 && fails(engine, k, text)) key = k;
+			}
+			if (key.reflector != 0)
+			{
+				MachineState k = key;
+				k.reflector = 0;
+				if (fails(engine, k, text)) key = k;
+			}
+
+			Counterexample ce;
+			ce.engine = engine.name;
+			ce.caseIndex = index;
+			ce.key = key;
+			ce.text = text;
+			ce.expected = reference(key, text);
+			ce.actual = engine.encrypt(key, text);
+			return ce;
+		}
+
+		ValidationConfig m_cfg;
+	};
+}
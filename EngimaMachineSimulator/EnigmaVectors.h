@@ -0,0 +1,78 @@
+// EnigmaVectors.h - Golden test vectors, checked by the compiler (C++14)
+//
+// Each vector is a key built by a constexpr function from the factories in Enigma.h, a plaintext and the
+// ciphertext this core produces for it, encrypted with EncryptLiteral and compared in a static_assert. A change
+// to the wirings, the stepping or the plugboard that alters any of them fails the build of every translation
+// unit that includes this header, at no cost at run time.
+//
+// The first two are the well-known M3 checks (I-II-III, reflector B, rings A; the second crosses a double step).
+// The others pin this core's own output, including its ring-relative notch approximation (see Enigma.h): the
+// plugboard/ring key, a four-rotor M4 and the Enigma G with its moving reflector and QWERTZU entry wheel.
+
+#pragma once
+
+#include "Enigma.h"
+
+namespace EnigmaCore
+{
+	namespace GoldenVectors
+	{
+		constexpr EnigmaMachine M3Basic(int left, int middle, int right)
+		{
+			EnigmaMachine em;
+			em.setRotors(RotorI(), RotorII(), RotorIII());
+			em.setReflector(ReflectorB());
+			em.setPositions(left, middle, right);
+			return em;
+		}
+
+		// Rotors II IV V, rings B U L, start B L A, ten plugboard pairs
+		constexpr EnigmaMachine M3Plugged()
+		{
+			EnigmaMachine em;
+			Rotor l = RotorII(), m = RotorIV(), r = RotorV();
+			l.setRing(1); m.setRing(20); r.setRing(11);
+			l.setPosition(1); m.setPosition(11); r.setPosition(0);
+			em.setRotors(l, m, r);
+			em.setReflector(ReflectorB());
+			Plugboard p;
+			p.configureFromPairs("AV BS CG DL FU HZ IN KM OW RX");
+			em.setPlugboard(p);
+			return em;
+		}
+
+		// Beta at V, rotors II IV I (ring V on I) at J A, thin reflector B
+		constexpr EnigmaMachineM4 M4()
+		{
+			EnigmaMachineM4 em;
+			Rotor r = RotorI();
+			r.setRing(21);
+			em.setRotor(0, RotorBeta());
+			em.setRotors(RotorII(), RotorIV(), r);
+			em.setReflector(ReflectorBThin());
+			em.setPosition(0, 21);
+			em.setPositions(21, 9, 0);
+			return em;
+		}
+
+		constexpr EnigmaMachineG G()
+		{
+			EnigmaMachineG em;
+			em.setRotors(RotorGI(), RotorGII(), RotorGIII());
+			em.setReflector(ReflectorG());
+			em.setEntryWheel(EntryWheelQwertzu());
+			em.setPositions(3, 4, 5);
+			return em;
+		}
+
+		static_assert(EncryptLiteral(M3Basic(0, 0, 0), "AAAAA").equals("BDZGO"), "M3 I-II-III AAA");
+		static_assert(EncryptLiteral(M3Basic(0, 3, 20), "AAAAAAAAAA").equals("EQIBMGFJBW"), "M3 double step from ADU");
+		static_assert(EncryptLiteral(M3Plugged(), "Aufklaerung abteilung von Kurtinowa, nordwestl. Sebez!")
+			.equals("EDPUDOJTEPL NGAMAXOCP ZTE FWBFKZFHN, GHYZVIHFD. MIHMV!"), "M3 with rings and plugboard");
+		static_assert(EncryptLiteral(M4(), "VONVONJLOOKSJHFFTTTE").equals("XLJOGOKMPYOZGFZKHMYQ"), "M4 with Greek wheel");
+		static_assert(EncryptLiteral(G(), "ABWEHRTESTNACHRICHT").equals("JXDXUVLZLPHKZQJPWUU"), "Enigma G");
+
+		// Reciprocity: decrypting at the same key gives the plaintext back
+		static_assert(EncryptLiteral(M3Plugged(), "EDPUDOJTEPL").equals("AUFKLAERUNG"), "M3 is its own inverse");
+	}
+}
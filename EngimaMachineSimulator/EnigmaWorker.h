@@ -0,0 +1,184 @@
+// EnigmaWorker.h - Background encryption with progress, chunked results and cancellation (C++14)
+//
+// An EncryptionWorker owns one thread that encrypts a text under a key while the caller carries on. A job is
+// encrypted by appending the text chunk by chunk to an IncrementalSession (EnigmaSession.h):
+// - after every chunk the worker calls onChunk with that part of the ciphertext and how far the job has got;
+// - at the end it calls onDone with the session, which the consumer may move from (it then has the plaintext,
+//   the ciphertext and the checkpoints, ready for incremental edits).
+// Both are called on the worker thread. A GUI hands them to its own thread (a posted message, say). Like the
+// session, a worker takes the character type of its texts: BasicEncryptionWorker<EnigmaMachine, wchar_t>.
+//
+// Only the newest job matters. submit() replaces a job still waiting and makes a running one stop at its next
+// chunk; cancel() does the same without a new job. A stopped job makes no more calls, but calls already made
+// may still be on their way to the consumer's thread, so the consumer keeps the id submit() returned and
+// ignores other jobs' chunks.
+//
+//   EncryptionWorker worker(onChunk, onDone);
+//   uint64_t job = worker.submit(key, text); // returns at once
+
+#pragma once
+
+#include "Enigma.h"
+#include "EnigmaSession.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace EnigmaCore
+{
+	// Part of a job's ciphertext: text is ciphertext[offset, offset + text.size()).
+	template <class CharT>
+	struct BasicEncryptionChunk
+	{
+		uint64_t job{ 0 };
+		size_t offset{ 0 };
+		std::basic_string<CharT> text;
+		size_t total{ 0 }; // characters in the whole job; offset + text.size() of them are done
+	};
+
+	typedef BasicEncryptionChunk<char> EncryptionChunk;
+
+	template <class Machine, class CharT = char>
+	class BasicEncryptionWorker
+	{
+	public:
+		typedef BasicIncrementalSession<Machine, CharT> Session;
+		typedef typename Session::String String;
+		typedef BasicEncryptionChunk<CharT> Chunk;
+		typedef std::function<void(const Chunk&)> ChunkHandler;
+		typedef std::function<void(uint64_t job, Session& session)> DoneHandler;
+
+		static const size_t kDefaultChunkSize = 64 * 1024; // characters
+
+		BasicEncryptionWorker(ChunkHandler onChunk, DoneHandler onDone, size_t chunkSize = kDefaultChunkSize)
+			: m_onChunk(std::move(onChunk)), m_onDone(std::move(onDone)), m_chunkSize(chunkSize ? chunkSize : 1)
+		{
+			m_thread = std::thread([this] { threadMain(); });
+		}
+
+		// Stops the running job and joins the thread; no calls are made after this returns.
+		~BasicEncryptionWorker()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_shutdown = true;
+				m_current.store(0);
+			}
+			m_wake.notify_all();
+			m_thread.join();
+		}
+
+		BasicEncryptionWorker(const BasicEncryptionWorker&) = delete;
+		BasicEncryptionWorker& operator=(const BasicEncryptionWorker&) = delete;
+
+		// Encrypt text under key, instead of any unfinished job. Returns the job's id (never 0).
+		uint64_t submit(const Machine& key, String text)
+		{
+			uint64_t id;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				id = ++m_lastId;
+				m_next.id = id;
+				m_next.key = key;
+				m_next.text = std::move(text);
+				m_pending = true;
+				m_current.store(id);
+			}
+			m_wake.notify_all();
+			return id;
+		}
+
+		// Stop the running job and drop a waiting one.
+		void cancel()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_pending = false;
+				m_next.text.clear();
+				m_current.store(0);
+			}
+			m_idle.notify_all(); // wait() may be idle now without the worker thread ever seeing the dropped job
+		}
+
+		// Block until no job is waiting or running.
+		void wait()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_idle.wait(lock, [this] { return !m_pending && !m_running; });
+		}
+
+	private:
+		struct Job
+		{
+			uint64_t id{ 0 };
+			Machine key;
+			String text;
+		};
+
+		void threadMain()
+		{
+			for (;;)
+			{
+				Job job;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_wake.wait(lock, [this] { return m_shutdown || m_pending; });
+					if (m_shutdown) return;
+					job = std::move(m_next);
+					m_next.text.clear();
+					m_pending = false;
+					m_running = true;
+				}
+				run(job);
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_running = false;
+				}
+				m_idle.notify_all();
+			}
+		}
+
+		bool stopped(const Job& job) const { return m_current.load(std::memory_order_relaxed) != job.id; }
+
+		void run(const Job& job)
+		{
+			Session session(job.key);
+			typename Session::Patch append;
+			for (size_t offset = 0; offset < job.text.size(); offset += m_chunkSize)
+			{
+				if (stopped(job)) return;
+				append.offset = offset;
+				append.inserted.assign(job.text, offset, m_chunkSize);
+				Chunk chunk;
+				chunk.job = job.id;
+				chunk.offset = offset;
+				chunk.text = session.apply(append).inserted;
+				chunk.total = job.text.size();
+				if (m_onChunk) m_onChunk(chunk);
+			}
+			if (stopped(job)) return;
+			if (m_onDone) m_onDone(job.id, session);
+		}
+
+		ChunkHandler m_onChunk;
+		DoneHandler m_onDone;
+		const size_t m_chunkSize;
+
+		std::mutex m_mutex;
+		std::condition_variable m_wake, m_idle;
+		Job m_next; // waiting job, if m_pending
+		bool m_pending{ false };
+		bool m_running{ false };
+		bool m_shutdown{ false };
+		uint64_t m_lastId{ 0 };
+		std::atomic<uint64_t> m_current{ 0 }; // the job that should run; anything else stops
+		std::thread m_thread;
+	};
+
+	typedef BasicEncryptionWorker<EnigmaMachine> EncryptionWorker;
+}
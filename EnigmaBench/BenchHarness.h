@@ -0,0 +1,244 @@
+// BenchHarness.h - Timing, JSON reporting and baseline comparison for EnigmaBench (C++14)
+//
+// Every benchmark is a body(iterations) callable. MeasureSecondsPerOp first grows the iteration count until
+// one batch runs for at least minSeconds (so timer resolution and call overhead do not matter), then repeats
+// the batch and keeps the fastest per-iteration time; the minimum is the least noisy estimate on a shared
+// machine. Results carry their unit and direction so the baseline comparison needs no per-benchmark knowledge.
+//
+// Report format (one result per line so diffs of stored baselines stay readable):
+//   { "schema": "enigma-bench/1", "cpu": {...}, "compiler": "...", "build": "release",
+//     "dispatch": {...}, "profile": [ {"name": "...", "per": "letter", "ops": 123, "counters": {...}}, ... ],
+//     "results": [ {"name": "...", "unit": "...", "value": 1.5, "higherIsBetter": true}, ... ] }
+// "profile" holds hardware counter readings (EnigmaPerf.h) and is only present in --perf runs; it is not
+// part of the baseline comparison.
+
+#pragma once
+
+#include "EnigmaCpu.h"
+#include "EnigmaPerf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace EnigmaBench
+{
+	struct BenchResult
+	{
+		std::string name;
+		std::string unit;
+		double value{ 0.0 };
+		bool higherIsBetter{ true };
+	};
+
+	// Hardware counters over one batch of a benchmark, normalised per letter/byte/key.
+	struct ProfileResult
+	{
+		std::string name;
+		std::string per; // what one op is
+		uint64_t ops{ 0 };
+		EnigmaCore::PerfReading reading;
+	};
+
+	struct BenchReport
+	{
+		std::vector<BenchResult> results;
+		std::vector<ProfileResult> profiles;
+		std::string dispatch; // EngineDispatcher::diagnostics(), if any engine was dispatched
+	};
+
+	struct BenchOptions
+	{
+		double minSeconds{ 0.2 }; // per timed batch
+		int repetitions{ 3 }; // timed batches after calibration; the fastest counts
+	};
+
+	// Results that the optimiser must not drop are folded in here.
+	inline volatile uint64_t& Sink()
+	{
+		static volatile uint64_t sink = 0;
+		return sink;
+	}
+
+	template <class Body>
+	double TimeSeconds(Body& body, uint64_t iterations)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		body(iterations);
+		auto t1 = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(t1 - t0).count();
+	}
+
+	// Best seconds per iteration of body(iterations). The calibrated batch size is stored in *iterationsOut.
+	template <class Body>
+	double MeasureSecondsPerOp(const BenchOptions& opt, Body body, uint64_t* iterationsOut = nullptr)
+	{
+		uint64_t iterations = 1;
+		double t = TimeSeconds(body, iterations);
+		while (t < opt.minSeconds && iterations < (1ull << 40))
+		{
+			// Aim a little past the target so the next batch usually qualifies.
+			double grow = t > 0.0 ? 1.2 * opt.minSeconds / t : 100.0;
+			grow = (std::min)(100.0, (std::max)(2.0, grow));
+			iterations = (uint64_t)((double)iterations * grow);
+			t = TimeSeconds(body, iterations);
+		}
+		double best = t / (double)iterations;
+		for (int r = 1; r < opt.repetitions; ++r)
+		{
+			best = (std::min)(best, TimeSeconds(body, iterations) / (double)iterations);
+		}
+		if (iterationsOut) *iterationsOut = iterations;
+		return best;
+	}
+
+	inline std::string JsonEscape(const std::string& s)
+	{
+		std::string out;
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\') { out += '\\'; out += c; }
+			else if ((unsigned char)c < 0x20) out += ' ';
+			else out += c;
+		}
+		return out;
+	}
+
+	inline std::string CompilerName()
+	{
+		char buf[64];
+#if defined(__clang__)
+		std::snprintf(buf, sizeof(buf), "clang %d.%d.%d", __clang_major__, __clang_minor__, __clang_patchlevel__);
+#elif defined(_MSC_VER)
+		std::snprintf(buf, sizeof(buf), "msvc %d", _MSC_FULL_VER);
+#elif defined(__GNUC__)
+		std::snprintf(buf, sizeof(buf), "gcc %d.%d.%d", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+#else
+		std::snprintf(buf, sizeof(buf), "unknown");
+#endif
+		return buf;
+	}
+
+	inline std::string ReportToJson(const BenchReport& report)
+	{
+		const std::vector<BenchResult>& results = report.results;
+		const EnigmaCore::CpuInfo cpu = EnigmaCore::QueryCpuInfo();
+		std::ostringstream os;
+		os << "{\n";
+		os << "  \"schema\": \"enigma-bench/1\",\n";
+		os << "  \"cpu\": {\"brand\": \"" << JsonEscape(cpu.brand) << "\", \"hardwareThreads\": " << cpu.hardwareThreads << "},\n";
+		os << "  \"compiler\": \"" << JsonEscape(CompilerName()) << "\",\n";
+#if defined(NDEBUG)
+		os << "  \"build\": \"release\",\n";
+#else
+		os << "  \"build\": \"debug\",\n";
+#endif
+		if (!report.dispatch.empty()) os << "  \"dispatch\": " << report.dispatch << ",\n";
+		if (!report.profiles.empty())
+		{
+			os << "  \"profile\": [\n";
+			for (size_t i = 0; i < report.profiles.size(); ++i)
+			{
+				const ProfileResult& p = report.profiles[i];
+				os << "    {\"name\": \"" << JsonEscape(p.name) << "\", \"per\": \"" << JsonEscape(p.per) << "\", \"ops\": " << p.ops
+					<< ", \"counters\": " << p.reading.toJson(p.ops) << "}" << (i + 1 < report.profiles.size() ? ",\n" : "\n");
+			}
+			os << "  ],\n";
+		}
+		os << "  \"results\": [\n";
+		char value[64];
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchResult& r = results[i];
+			std::snprintf(value, sizeof(value), "%.6g", r.value);
+			os << "    {\"name\": \"" << JsonEscape(r.name) << "\", \"unit\": \"" << JsonEscape(r.unit)
+				<< "\", \"value\": " << value << ", \"higherIsBetter\": " << (r.higherIsBetter ? "true" : "false") << "}"
+				<< (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		os << "  ]\n}\n";
+		return os.str();
+	}
+
+	// Reads the "results" array of a report written by ReportToJson. Returns false if the file cannot be read.
+	// This is not a general JSON parser: it relies on the flat result objects that ReportToJson writes.
+	inline bool LoadBaseline(const std::string& path, std::vector<BenchResult>& out)
+	{
+		std::ifstream in(path.c_str(), std::ios::binary);
+		if (!in) return false;
+		std::stringstream ss;
+		ss << in.rdbuf();
+		const std::string s = ss.str();
+
+		auto stringAfter = [&](size_t from, const char* key, size_t limit, std::string& v) -> bool
+		{
+			size_t k = s.find(key, from);
+			if (k == std::string::npos || k >= limit) return false;
+			size_t q = s.find('"', k + std::strlen(key));
+			if (q == std::string::npos) return false;
+			size_t e = q + 1;
+			while (e < s.size() && s[e] != '"') e += (s[e] == '\\') ? 2 : 1;
+			v = s.substr(q + 1, e - q - 1);
+			return true;
+		};
+
+		out.clear();
+		size_t pos = s.find("\"results\"");
+		if (pos == std::string::npos) return false;
+		for (;;)
+		{
+			size_t open = s.find('{', pos);
+			if (open == std::string::npos) break;
+			size_t close = s.find('}', open);
+			if (close == std::string::npos) break;
+			BenchResult r;
+			size_t v = s.find("\"value\"", open);
+			size_t h = s.find("\"higherIsBetter\"", open);
+			if (stringAfter(open, "\"name\"", close, r.name) && stringAfter(open, "\"unit\"", close, r.unit) &&
+				v < close && h < close)
+			{
+				size_t colon = s.find(':', v);
+				r.value = std::strtod(s.c_str() + colon + 1, nullptr);
+				size_t flag = s.find_first_not_of(" \t", s.find(':', h) + 1);
+				r.higherIsBetter = flag < close && s.compare(flag, 4, "true") == 0;
+				out.push_back(r);
+			}
+			pos = close + 1;
+		}
+		return true;
+	}
+
+	// Prints a comparison table to stderr and returns the number of results that got worse than the baseline
+	// by more than `threshold` (0.10 = 10%). Results missing from either side are listed but never fail.
+	inline int CompareToBaseline(const std::vector<BenchResult>& current, const std::vector<BenchResult>& baseline, double threshold)
+	{
+		int regressions = 0;
+		std::fprintf(stderr, "\n%-24s %14s %14s %9s\n", "benchmark", "baseline", "current", "change");
+		for (const BenchResult& r : current)
+		{
+			const BenchResult* b = nullptr;
+			for (const BenchResult& x : baseline)
+			{
+				if (x.name == r.name && x.unit == r.unit) { b = &x; break; }
+			}
+			if (!b || b->value <= 0.0 || r.value <= 0.0)
+			{
+				std::fprintf(stderr, "%-24s %14s %14.4g %9s  %s\n", r.name.c_str(), "-", r.value, "-", r.unit.c_str());
+				continue;
+			}
+			// speedup > 1 means better, whatever the unit's direction
+			double speedup = r.higherIsBetter ? r.value / b->value : b->value / r.value;
+			bool regressed = speedup < 1.0 - threshold;
+			regressions += regressed;
+			std::fprintf(stderr, "%-24s %14.4g %14.4g %+8.1f%%  %s%s\n", r.name.c_str(), b->value, r.value,
+				(speedup - 1.0) * 100.0, r.unit.c_str(), regressed ? "  REGRESSION" : "");
+		}
+		return regressions;
+	}
+}
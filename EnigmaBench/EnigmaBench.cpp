@@ -0,0 +1,953 @@
+// EnigmaBench.cpp - Benchmarks for the Enigma core engine and search kernels (C++14)
+//
+// Measures:
+// - encryptChar           ns per letter on a configured machine (10 plugboard pairs)
+// - rotorpass_table/mod26 ns per letter for the three rotor passes and the reflector alone, once through the
+//                         pre-rotated tables (Rotor::forward/backward) and once with the modular arithmetic those
+//                         tables replaced, on the same wirings and stepping
+// - encrypt_1KB/1MB/1GB   EnigmaMachine::encrypt throughput on mixed text (letters, spaces, punctuation);
+//                         the 1 GB run streams 1 MB chunks through one machine and is skipped by --quick
+// - encrypt_m4_1MB        the same text on a four-rotor M4 (Greek wheel, thin reflector, two-notch rotor VI)
+// - encrypt_utf16_1M      encrypt on one million UTF-16 units, every other word Cyrillic (passed through)
+// - table_encrypt_1MB     the same on TableEngine; dispatch_encrypt_1MB through EngineDispatcher
+// - manykeys_<engine>     one 256-letter text under 256 keys per engine the CPU supports (EnigmaDispatch.h)
+// - construct             building a machine from rotor/reflector indices, rings and positions (as the view does)
+// - plugboard_parse       Plugboard::configureFromPairs on a 10-pair string
+// - replay_<strategy>_<event>_p50/p99/max
+//                         microseconds per event of an editing session replayed through a CipherEditor (the
+//                         document's code path, EnigmaEditor.h) with each EditorStrategy: full, incremental,
+//                         background. Events: type, delete, paste, rotor, plugboard. For background,
+//                         ..._ready_p50/p99/max is the time until the worker's ciphertext is in (events that
+//                         started a job). The session is synthetic (a 1 MB document) unless --replay names a
+//                         recording.
+// - search_<N>t           phase-1 key enumeration throughput (keys/s) with N scheduler threads, N = 1, 2, 4, ..
+//                         up to --threads (default: all hardware threads); same kernel as KeySearch::enumerate
+//
+// Usage: EnigmaBench [--quick] [--perf] [--filter SUBSTR] [--threads N] [--min-time S] [--reps R]
+//                    [--out FILE] [--baseline FILE] [--threshold F] [--replay FILE]
+// --perf runs each benchmark once more under hardware counters (EnigmaPerf.h, Linux) and adds cycles,
+// instructions, L1D/LLC misses and branch mispredicts per letter, byte, machine or key to the report.
+// The JSON report goes to --out (or stdout); progress and the baseline comparison go to stderr. The exit code
+// is 2 if any benchmark is more than --threshold (default 0.10) worse than the baseline, 1 on usage/IO errors
+// or if the replayed strategies end with different ciphertexts.
+//
+// A --replay file has one event per line (blank lines and lines starting with # are skipped):
+//   text N                  the document: N characters of generated text (first event only; default empty)
+//   type OFFSET TEXT        TEXT typed at OFFSET; the rest of the line, with \n, \t and \\ escapes
+//   paste OFFSET TEXT       the same as one paste
+//   delete OFFSET COUNT     COUNT characters removed at OFFSET
+//   rotor FIELD VALUE       a combo box changed: FIELD is reflector, rotor1..3, ring1..3 or position1..3
+//                           (left to right), VALUE the selected index
+//   plug PAIRS              the plugboard field's new text, e.g. "AV BS CG"
+
+#include "BenchHarness.h"
+
+#include "Enigma.h"
+#include "EnigmaDispatch.h"
+#include "EnigmaEditor.h"
+#include "EnigmaEngines.h"
+#include "EnigmaMachineCache.h"
+#include "EnigmaPerf.h"
+#include "EnigmaScheduler.h"
+#include "EnigmaSearch.h"
+#include "EnigmaState.h"
+#include "EnigmaTopK.h"
+#include "EnigmaWorker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace EnigmaCore;
+using namespace EnigmaBench;
+
+namespace
+{
+	const char* const kPlugPairs = "AV BS CG DL FU HZ IN KM OW RX";
+
+	struct Options
+	{
+		BenchOptions bench;
+		bool quick{ false };
+		bool perf{ false };
+		std::string filter;
+		unsigned maxThreads{ 0 };
+		std::string outPath;
+		std::string baselinePath;
+		double threshold{ 0.10 };
+		std::string replayPath;
+	};
+
+	EnigmaMachine MakeMachine()
+	{
+		EnigmaMachine em;
+		Rotor l = RotorByIndex(1), m = RotorByIndex(3), r = RotorByIndex(4);
+		l.setRing(6); m.setRing(12); r.setRing(24);
+		l.setPosition(3); m.setPosition(10); r.setPosition(15);
+		em.setRotors(l, m, r);
+		em.setReflector(ReflectorByIndex(0));
+		Plugboard p;
+		p.configureFromPairs(kPlugPairs);
+		em.setPlugboard(p);
+		return em;
+	}
+
+	// Naval M4 key: same plugboard, Greek wheel Beta, rotors VI (two notches), III, VIII.
+	EnigmaMachineM4 MakeMachineM4()
+	{
+		EnigmaMachineM4 em;
+		Rotor g = RotorByIndex(8), l = RotorByIndex(5), m = RotorByIndex(2), r = RotorByIndex(7);
+		g.setRing(4); l.setRing(6); m.setRing(12); r.setRing(24);
+		g.setPosition(17); l.setPosition(3); m.setPosition(10); r.setPosition(15);
+		em.setRotor(0, g);
+		em.setRotors(l, m, r);
+		em.setReflector(ReflectorByIndex(2));
+		Plugboard p;
+		p.configureFromPairs(kPlugPairs);
+		em.setPlugboard(p);
+		return em;
+	}
+
+	// Roughly English-shaped input: words of 2..9 letters, spaces, occasional punctuation and newlines.
+	std::string MakeText(size_t n, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::string s;
+		s.reserve(n);
+		while (s.size() < n)
+		{
+			int len = 2 + (int)(rng() % 8);
+			for (int i = 0; i < len && s.size() < n; ++i) s.push_back((char)('a' + rng() % 26));
+			if (s.size() < n)
+			{
+				uint32_t r = rng() % 16;
+				s.push_back(r == 0 ? '.' : r == 1 ? ',' : r == 2 ? '\n' : ' ');
+			}
+		}
+		return s;
+	}
+
+	bool Selected(const Options& opt, const std::string& name)
+	{
+		return opt.filter.empty() || name.find(opt.filter) != std::string::npos;
+	}
+
+	void Report(BenchReport& out, const std::string& name, const std::string& unit, double value, bool higherIsBetter)
+	{
+		BenchResult r;
+		r.name = name;
+		r.unit = unit;
+		r.value = value;
+		r.higherIsBetter = higherIsBetter;
+		std::fprintf(stderr, "%-24s %14.4g %s\n", name.c_str(), value, unit.c_str());
+		out.results.push_back(r);
+	}
+
+	// With --perf, run one more batch of `iterations` under hardware counters. Pass `counters` when they must be
+	// opened before the threads the body uses (see PerfCounters).
+	template <class Body>
+	void Profile(const Options& opt, BenchReport& out, const std::string& name, const char* per, uint64_t opsPerIteration,
+		Body& body, uint64_t iterations, PerfCounters* counters = nullptr)
+	{
+		if (!opt.perf) return;
+		std::unique_ptr<PerfCounters> own;
+		if (!counters)
+		{
+			own.reset(new PerfCounters(false));
+			counters = own.get();
+		}
+		if (!counters->available()) return;
+		ProfileResult p;
+		p.name = name;
+		p.per = per;
+		p.ops = opsPerIteration * iterations;
+		counters->start();
+		body(iterations);
+		p.reading = counters->stop();
+		if (p.reading.valid[kPerfCycles] && p.ops)
+			std::fprintf(stderr, "%-24s %14.4g cycles/%s\n", "", p.reading.value[kPerfCycles] / (double)p.ops, per);
+		out.profiles.push_back(p);
+	}
+
+	void BenchEncryptChar(const Options& opt, BenchReport& out)
+	{
+		if (!Selected(opt, "encryptChar")) return;
+		EnigmaMachine em = MakeMachine();
+		auto body = [&](uint64_t n)
+		{
+			uint64_t acc = 0;
+			int c = 0;
+			for (uint64_t i = 0; i < n; ++i)
+			{
+				acc += (unsigned char)em.encryptChar((char)('A' + c));
+				if (++c == 26) c = 0;
+			}
+			Sink() += acc;
+		};
+		uint64_t iterations = 0;
+		double s = MeasureSecondsPerOp(opt.bench, body, &iterations);
+		Report(out, "encryptChar", "ns/letter", s * 1e9, false);
+		Profile(opt, out, "encryptChar", "letter", 1, body, iterations);
+	}
+
+	// The rotor passes as they were computed before the pre-rotated tables: shift in by the offset, look up,
+	// shift back out, each with a mod26.
+	int ModularPass(const Rotor& r, const uint8_t* table, int i)
+	{
+		int o = r.position() - r.ring();
+		return mod26(table[mod26(i + o)] - o);
+	}
+
+	void BenchRotorPass(const Options& opt, BenchReport& out)
+	{
+		for (int modular = 0; modular < 2; ++modular)
+		{
+			const char* name = modular ? "rotorpass_mod26" : "rotorpass_table";
+			if (!Selected(opt, name)) continue;
+			EnigmaMachine em = MakeMachine();
+			Rotor l = em.leftRotor(), m = em.middleRotor(), r = em.rightRotor();
+			const Reflector u = em.reflector();
+			auto body = [&](uint64_t n)
+			{
+				uint64_t acc = 0;
+				int c = 0;
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					// ratchet stepping without the double step is enough to move all three offsets
+					r.step();
+					if (r.offset() == 0) { m.step(); if (m.offset() == 0) l.step(); }
+					int x = c;
+					if (modular)
+					{
+						x = ModularPass(r, r.wiring().fwd, x);
+						x = ModularPass(m, m.wiring().fwd, x);
+						x = ModularPass(l, l.wiring().fwd, x);
+						x = u.wiring().fwd[x];
+						x = ModularPass(l, l.wiring().rev, x);
+						x = ModularPass(m, m.wiring().rev, x);
+						x = ModularPass(r, r.wiring().rev, x);
+					}
+					else
+					{
+						x = l.forward(m.forward(r.forward(x)));
+						x = u.map(x);
+						x = r.backward(m.backward(l.backward(x)));
+					}
+					acc += (uint64_t)x;
+					if (++c == 26) c = 0;
+				}
+				Sink() += acc;
+			};
+			uint64_t iterations = 0;
+			double s = MeasureSecondsPerOp(opt.bench, body, &iterations);
+			Report(out, name, "ns/letter", s * 1e9, false);
+			Profile(opt, out, name, "letter", 1, body, iterations);
+		}
+	}
+
+	template <class Machine>
+	void BenchEncrypt(const Options& opt, BenchReport& out, const char* name, size_t bytes, Machine em)
+	{
+		if (!Selected(opt, name)) return;
+		const std::string text = MakeText(bytes, 1);
+		auto body = [&](uint64_t n)
+		{
+			for (uint64_t i = 0; i < n; ++i) Sink() += (unsigned char)em.encrypt(text)[bytes / 2];
+		};
+		uint64_t iterations = 0;
+		double s = MeasureSecondsPerOp(opt.bench, body, &iterations);
+		Report(out, name, "MB/s", (double)bytes / s / 1e6, true);
+		Profile(opt, out, name, "byte", bytes, body, iterations);
+	}
+
+	// MakeText as UTF-16, with every other word in Cyrillic (U+0430..U+0449), which the machine passes through
+	void BenchEncryptUtf16(const Options& opt, BenchReport& out)
+	{
+		const char* name = "encrypt_utf16_1M";
+		if (!Selected(opt, name)) return;
+		const size_t units = 1 << 20;
+		const std::string ascii = MakeText(units, 1);
+		std::u16string text(units, u' ');
+		bool cyrillic = false;
+		for (size_t i = 0; i < units; ++i)
+		{
+			const int x = ch2i(ascii[i]);
+			if (x < 0) cyrillic = !cyrillic;
+			text[i] = x >= 0 && cyrillic ? (char16_t)(0x430 + x) : (char16_t)(unsigned char)ascii[i];
+		}
+		EnigmaMachine em = MakeMachine();
+		auto body = [&](uint64_t n)
+		{
+			for (uint64_t i = 0; i < n; ++i) Sink() += em.encrypt(text)[units / 2];
+		};
+		uint64_t iterations = 0;
+		double s = MeasureSecondsPerOp(opt.bench, body, &iterations);
+		Report(out, name, "Munits/s", (double)units / s / 1e6, true);
+		Profile(opt, out, name, "unit", units, body, iterations);
+	}
+
+	void BenchEngineEncrypt(const Options& opt, BenchReport& out)
+	{
+		const size_t bytes = 1 << 20;
+		const std::string text = MakeText(bytes, 1);
+		for (int dispatched = 0; dispatched < 2; ++dispatched)
+		{
+			const char* name = dispatched ? "dispatch_encrypt_1MB" : "table_encrypt_1MB";
+			if (!Selected(opt, name)) continue;
+			EnigmaMachine em = MakeMachine();
+			TableEngine te(em);
+			auto body = [&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					const std::string c = dispatched ? EngineDispatcher::instance().encrypt(em, text) : te.encrypt(text);
+					Sink() += (unsigned char)c[bytes / 2];
+				}
+			};
+			uint64_t iterations = 0;
+			double s = MeasureSecondsPerOp(opt.bench, body, &iterations);
+			Report(out, name, "MB/s", (double)bytes / s / 1e6, true);
+			Profile(opt, out, name, "byte", bytes, body, iterations);
+		}
+	}
+
+	void BenchManyKeys(const Options& opt, BenchReport& out)
+	{
+		const size_t keys = 256, len = 256;
+		std::vector<EnigmaMachine> machines(keys);
+		std::mt19937 rng(4);
+		for (EnigmaMachine& em : machines)
+		{
+			Rotor r[3] = { RotorByIndex((int)(rng() % 5)), RotorByIndex((int)(rng() % 5)), RotorByIndex((int)(rng() % 5)) };
+			for (Rotor& x : r)
+			{
+				x.setRing((int)(rng() % 26));
+				x.setPosition((int)(rng() % 26));
+			}
+			em.setRotors(r[0], r[1], r[2]);
+			em.setReflector(ReflectorByIndex((int)(rng() % 2)));
+		}
+		std::vector<uint8_t> text(len), result(keys * len);
+		for (uint8_t& c : text) c = (uint8_t)(rng() % 26);
+
+		for (int e = 0; e < kEngineCount; ++e)
+		{
+			const std::string name = std::string("manykeys_") + EngineName((EngineKind)e);
+			if (!EngineDispatcher::instance().supports((EngineKind)e) || !Selected(opt, name)) continue;
+			auto body = [&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; ++i)
+					EngineDispatcher::runManyKeys((EngineKind)e, machines.data(), keys, text.data(), len, result.data());
+				Sink() += result[keys * len / 2];
+			};
+			uint64_t iterations = 0;
+			double s = MeasureSecondsPerOp(opt.bench, body, &iterations);
+			Report(out, name, "Mletters/s", (double)(keys * len) / s / 1e6, true);
+			Profile(opt, out, name, "letter", keys * len, body, iterations);
+		}
+	}
+
+	// 1 GB does not fit the calibrate-and-repeat scheme (and should not need 2 GB of RAM): stream 1 MB chunks
+	// through one machine, once.
+	void BenchEncryptStream(const Options& opt, BenchReport& out)
+	{
+		const char* name = "encrypt_1GB";
+		if (opt.quick || !Selected(opt, name)) return;
+		const size_t chunk = 1 << 20, chunks = 1024;
+		const std::string text = MakeText(chunk, 2);
+		EnigmaMachine em = MakeMachine();
+		auto body = [&](uint64_t n)
+		{
+			for (uint64_t i = 0; i < n; ++i) Sink() += (unsigned char)em.encrypt(text)[i % chunk];
+		};
+		double s = TimeSeconds(body, chunks);
+		Report(out, name, "MB/s", (double)chunk * chunks / s / 1e6, true);
+		Profile(opt, out, name, "byte", chunk, body, chunks);
+	}
+
+	void BenchConstruct(const Options& opt, BenchReport& out)
+	{
+		if (!Selected(opt, "construct")) return;
+		auto body = [&](uint64_t n)
+		{
+			for (uint64_t i = 0; i < n; ++i)
+			{
+				int k = (int)(i % 5);
+				EnigmaMachine em;
+				Rotor l = RotorByIndex(k), m = RotorByIndex((k + 1) % 5), r = RotorByIndex((k + 2) % 5);
+				l.setRing((int)i); m.setRing((int)i + 1); r.setRing((int)i + 2);
+				l.setPosition((int)i + 3); m.setPosition((int)i + 4); r.setPosition((int)i + 5);
+				em.setRotors(l, m, r);
+				em.setReflector(ReflectorByIndex((int)(i & 1)));
+				em.setPlugboard(Plugboard());
+				Sink() += (uint64_t)em.rightPos();
+			}
+		};
+		uint64_t iterations = 0;
+		double s = MeasureSecondsPerOp(opt.bench, body, &iterations);
+		Report(out, "construct", "ns/machine", s * 1e9, false);
+		Profile(opt, out, "construct", "machine", 1, body, iterations);
+	}
+
+	void BenchPlugboardParse(const Options& opt, BenchReport& out)
+	{
+		if (!Selected(opt, "plugboard_parse")) return;
+		const std::string pairs = kPlugPairs;
+		auto body = [&](uint64_t n)
+		{
+			Plugboard p;
+			for (uint64_t i = 0; i < n; ++i)
+			{
+				p.configureFromPairs(pairs);
+				Sink() += (uint64_t)p.map((int)i);
+			}
+		};
+		uint64_t iterations = 0;
+		double s = MeasureSecondsPerOp(opt.bench, body, &iterations);
+		Report(out, "plugboard_parse", "ns/parse", s * 1e9, false);
+		Profile(opt, out, "plugboard_parse", "parse", 1, body, iterations);
+	}
+
+	// A machine for one of a handful of keys from a MachineCache, as a batch service serving the same keys does
+	void BenchConstructCached(const Options& opt, BenchReport& out)
+	{
+		if (!Selected(opt, "construct_cached")) return;
+		MachineState keys[8];
+		for (int k = 0; k < 8; ++k)
+		{
+			keys[k].reflector = (uint8_t)(k & 1);
+			for (int j = 0; j < 3; ++j)
+			{
+				keys[k].rotors[j] = (uint8_t)((k + j) % 5);
+				keys[k].rings[j] = (uint8_t)(k + j);
+				keys[k].positions[j] = (uint8_t)(3 * k + j);
+			}
+			for (int i = 0; i < 26; ++i) keys[k].plug[i] = (uint8_t)i;
+		}
+		MachineCache cache;
+		auto body = [&](uint64_t n)
+		{
+			EnigmaMachine em;
+			for (uint64_t i = 0; i < n; ++i)
+			{
+				cache.get(keys[i & 7], em);
+				Sink() += (uint64_t)em.rightPos();
+			}
+		};
+		uint64_t iterations = 0;
+		double s = MeasureSecondsPerOp(opt.bench, body, &iterations);
+		Report(out, "construct_cached", "ns/machine", s * 1e9, false);
+		Profile(opt, out, "construct_cached", "machine", 1, body, iterations);
+	}
+
+	// Phase-1 enumeration kernel over a fixed slice of the key space: decode, build, score, collect.
+	void BenchSearch(const Options& opt, BenchReport& out)
+	{
+		std::vector<unsigned> counts;
+		for (unsigned t = 1; t < opt.maxThreads; t *= 2) counts.push_back(t);
+		counts.push_back(opt.maxThreads);
+		std::vector<std::string> names;
+		for (unsigned t : counts) names.push_back("search_" + std::to_string(t) + "t");
+		if (std::none_of(names.begin(), names.end(), [&](const std::string& n) { return Selected(opt, n); })) return;
+
+		const uint64_t keys = 1 << 17;
+		const uint64_t grain = 256;
+
+		// Ciphertext of a known key, the same length as a typical intercept.
+		std::vector<uint8_t> text;
+		{
+			EnigmaMachine em = MakeMachine();
+			for (char c : em.encrypt(MakeText(180, 3)))
+			{
+				int i = ch2i(c);
+				if (i != -1) text.push_back((uint8_t)i);
+			}
+		}
+		KeySpace space;
+		ComponentSet components;
+
+		for (size_t ci = 0; ci < counts.size(); ++ci)
+		{
+			const unsigned threads = counts[ci];
+			if (!Selected(opt, names[ci])) continue;
+			// Counters first, so that they are inherited by the scheduler's pool threads.
+			std::unique_ptr<PerfCounters> counters;
+			if (opt.perf) counters.reset(new PerfCounters(true));
+			WorkStealingScheduler scheduler(threads);
+			std::vector<KeyBatchScorer> scorers(threads, KeyBatchScorer(text));
+			ConcurrentTopK<SearchCandidate> collector(10, threads);
+			WorkStealingScheduler::RangeBody body = [&](uint64_t b, uint64_t e, unsigned w)
+			{
+				scorers[w].score(space, components, b, e, [&](const SearchCandidate& c) { collector.offer(w, c); });
+			};
+			auto run = [&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; ++i)
+				{
+					collector.clear();
+					scheduler.parallelFor(0, keys, grain, body);
+				}
+				Sink() += collector.cutoff();
+			};
+			uint64_t iterations = 0;
+			double s = MeasureSecondsPerOp(opt.bench, run, &iterations);
+			Report(out, names[ci], "keys/s", (double)keys / s, true);
+			Profile(opt, out, names[ci], "key", keys, run, iterations, counters.get());
+		}
+	}
+
+	// An editing session to replay: the document it starts from and what the user does to it. The settings start
+	// as MakeState() and change with the rotor and plugboard events.
+	struct EditEvent
+	{
+		enum Kind { kType, kDelete, kPaste, kRotor, kPlugboard, kKinds };
+		Kind kind{ kType };
+		size_t offset{ 0 };
+		size_t count{ 0 }; // kDelete
+		std::string text; // kType, kPaste; kPlugboard: the pairs
+		int field{ 0 }; // kRotor: 0 reflector, 1..3 rotors, 4..6 rings, 7..9 positions, left to right
+		int value{ 0 }; // kRotor: the selected index
+	};
+	const char* const kEventNames[EditEvent::kKinds] = { "type", "delete", "paste", "rotor", "plugboard" };
+	const char* const kFieldNames[10] = { "reflector", "rotor1", "rotor2", "rotor3", "ring1", "ring2", "ring3",
+		"position1", "position2", "position3" };
+
+	struct EditSession
+	{
+		std::string document;
+		std::vector<EditEvent> events;
+	};
+
+	// MakeMachine's settings as the view's combo boxes and plugboard field hold them
+	MachineState MakeState()
+	{
+		MachineState st;
+		const uint8_t rotors[3] = { 1, 3, 4 }, rings[3] = { 6, 12, 24 }, positions[3] = { 3, 10, 15 };
+		for (int i = 0; i < 3; ++i)
+		{
+			st.rotors[i] = rotors[i];
+			st.rings[i] = rings[i];
+			st.positions[i] = positions[i];
+		}
+		Plugboard p;
+		p.configureFromPairs(kPlugPairs);
+		for (int i = 0; i < 26; ++i) st.plug[i] = (uint8_t)p.map(i);
+		return st;
+	}
+
+	void SetField(MachineState& st, int field, int value)
+	{
+		const uint8_t v = (uint8_t)value;
+		if (field == 0) st.reflector = v;
+		else if (field <= 3) st.rotors[field - 1] = v;
+		else if (field <= 6) st.rings[field - 4] = v;
+		else st.positions[field - 7] = v;
+	}
+
+	// Rounds of: a burst of typing somewhere with the last letters taken back, a paste (one of them long enough
+	// for the worker), a sentence deleted, the right rotor stepped on three times, another middle rotor, and
+	// every fourth round a new plugboard.
+	EditSession SyntheticEditSession(size_t documentChars, int rounds, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		EditSession session;
+		session.document = MakeText(documentChars, seed);
+		size_t size = session.document.size();
+		auto add = [&](EditEvent::Kind kind, size_t offset) -> EditEvent&
+		{
+			session.events.push_back(EditEvent());
+			session.events.back().kind = kind;
+			session.events.back().offset = offset;
+			return session.events.back();
+		};
+		for (int r = 0; r < rounds; ++r)
+		{
+			size_t pos = rng() % (size + 1);
+			for (char c : MakeText(24, rng()))
+			{
+				add(EditEvent::kType, pos++).text.assign(1, c);
+				++size;
+			}
+			for (int k = 0; k < 4; ++k)
+			{
+				add(EditEvent::kDelete, --pos).count = 1;
+				--size;
+			}
+			const size_t pasted = r == rounds / 2 ? 300 * 1024 : 2048;
+			add(EditEvent::kPaste, rng() % (size + 1)).text = MakeText(pasted, rng());
+			size += pasted;
+			pos = rng() % (size + 1);
+			const size_t removed = (std::min)(size - pos, (size_t)200);
+			add(EditEvent::kDelete, pos).count = removed;
+			size -= removed;
+			for (int k = 1; k <= 3; ++k)
+			{
+				EditEvent& e = add(EditEvent::kRotor, 0);
+				e.field = 9;
+				e.value = (15 + 3 * r + k) % 26;
+			}
+			EditEvent& middle = add(EditEvent::kRotor, 0);
+			middle.field = 2;
+			middle.value = (3 + r) % 8;
+			if (r % 4 == 3)
+			{
+				std::string letters = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+				std::shuffle(letters.begin(), letters.end(), rng);
+				std::string& pairs = add(EditEvent::kPlugboard, 0).text;
+				for (size_t i = 0; i < 20; i += 2)
+				{
+					pairs.append(letters, i, 2);
+					pairs.push_back(' ');
+				}
+			}
+		}
+		return session;
+	}
+
+	std::string Unescape(const std::string& s)
+	{
+		std::string out;
+		for (size_t i = 0; i < s.size(); ++i)
+		{
+			if (s[i] != '\\' || i + 1 == s.size())
+			{
+				out.push_back(s[i]);
+				continue;
+			}
+			const char c = s[++i];
+			out.push_back(c == 'n' ? '\n' : c == 't' ? '\t' : c);
+		}
+		return out;
+	}
+
+	// Reads a recorded session (format at the top of this file).
+	bool LoadEditSession(const std::string& path, EditSession& out, std::string* error)
+	{
+		std::ifstream f(path.c_str(), std::ios::binary);
+		if (!f)
+		{
+			if (error) *error = "cannot read " + path;
+			return false;
+		}
+		EditSession session;
+		std::string line;
+		for (int lineNo = 1; std::getline(f, line); ++lineNo)
+		{
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (line.empty() || line[0] == '#') continue;
+			const size_t space = line.find(' ');
+			const std::string verb = line.substr(0, space);
+			const std::string rest = space == std::string::npos ? std::string() : line.substr(space + 1);
+			const size_t space2 = rest.find(' ');
+			const std::string arg = rest.substr(0, space2);
+			const std::string tail = space2 == std::string::npos ? std::string() : rest.substr(space2 + 1);
+			auto number = [](const std::string& s, unsigned long long& n)
+			{
+				char* end = nullptr;
+				n = std::strtoull(s.c_str(), &end, 10);
+				return !s.empty() && *end == '\0';
+			};
+			unsigned long long n = 0, m = 0;
+			EditEvent e;
+			bool ok = true;
+			if (verb == "text")
+			{
+				ok = number(arg, n) && session.events.empty();
+				if (ok)
+				{
+					session.document = MakeText((size_t)n, 2);
+					continue;
+				}
+			}
+			else if (verb == "type" || verb == "paste")
+			{
+				ok = number(arg, n);
+				e.kind = verb == "type" ? EditEvent::kType : EditEvent::kPaste;
+				e.offset = (size_t)n;
+				e.text = Unescape(tail);
+			}
+			else if (verb == "delete")
+			{
+				ok = number(arg, n) && number(tail, m);
+				e.kind = EditEvent::kDelete;
+				e.offset = (size_t)n;
+				e.count = (size_t)m;
+			}
+			else if (verb == "rotor")
+			{
+				e.kind = EditEvent::kRotor;
+				e.field = (int)(std::find(kFieldNames, kFieldNames + 10, arg) - kFieldNames);
+				ok = e.field < 10 && number(tail, m) && m < 26;
+				e.value = (int)m;
+			}
+			else if (verb == "plug")
+			{
+				e.kind = EditEvent::kPlugboard;
+				e.text = rest;
+			}
+			else
+			{
+				ok = false;
+			}
+			if (!ok)
+			{
+				if (error) *error = path + ":" + std::to_string(lineNo) + ": cannot parse \"" + line + "\"";
+				return false;
+			}
+			session.events.push_back(e);
+		}
+		out = std::move(session);
+		return true;
+	}
+
+	struct ReplayTimes
+	{
+		std::vector<double> handled[EditEvent::kKinds]; // microseconds until the view's handler returns
+		std::vector<double> ready[EditEvent::kKinds]; // until the worker's ciphertext is in (events that started a job)
+		std::string shown; // the cipher control at the end
+	};
+
+	// Replay `session` as the view handles each event: UpdatePlainText for edits, OnConfigChanged/OnComboChanged
+	// and UpdateCiphertext for settings, StartBackgroundEncryption and OnCipherReady when the worker takes over.
+	// `shown` stands in for the cipher control. A job is waited for before the next event.
+	ReplayTimes Replay(const EditSession& session, EditorStrategy strategy)
+	{
+		typedef std::chrono::steady_clock Clock;
+		auto micros = [](Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); };
+
+		std::mutex mutex;
+		uint64_t doneJob = 0;
+		CipherEditor::Session done;
+		EncryptionWorker worker(nullptr, [&](uint64_t job, EncryptionWorker::Session& s)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			doneJob = job;
+			std::swap(done, s);
+		});
+
+		// A cache of its own, so every strategy starts with the same (cold) one
+		MachineCache cache;
+		MachineState state = MakeState();
+		EnigmaMachine em;
+		cache.get(state, em);
+		CipherEditor editor(strategy);
+		editor.setKey(em);
+		editor.load(session.document);
+
+		ReplayTimes times;
+		std::string& shown = times.shown;
+		shown = editor.ciphertext();
+		for (const EditEvent& e : session.events)
+		{
+			const Clock::time_point start = Clock::now();
+			if (e.kind == EditEvent::kRotor || e.kind == EditEvent::kPlugboard)
+			{
+				if (e.kind == EditEvent::kRotor)
+				{
+					SetField(state, e.field, e.value);
+				}
+				else
+				{
+					Plugboard p;
+					p.configureFromPairs(e.text);
+					for (int i = 0; i < 26; ++i) state.plug[i] = (uint8_t)p.map(i);
+				}
+				if (!cache.get(state, em)) continue;
+				if (editor.setKey(em)) shown = editor.ciphertext();
+			}
+			else
+			{
+				CipherEditor::Patch edit;
+				edit.offset = e.offset;
+				edit.removed = e.count;
+				edit.inserted = e.text;
+				const CipherEditor::Patch change = editor.edit(edit);
+				if (editor.isCipherCurrent())
+				{
+					if (change.offset + change.removed <= shown.size()) change.applyTo(shown);
+					else shown = editor.ciphertext();
+				}
+			}
+			const bool background = !editor.isCipherCurrent();
+			const uint64_t job = background ? worker.submit(editor.key(), editor.plaintext().str()) : 0;
+			times.handled[e.kind].push_back(micros(Clock::now() - start));
+			if (!background) continue;
+			worker.wait();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (doneJob == job) editor.endSetKey(done);
+			}
+			shown = editor.ciphertext();
+			times.ready[e.kind].push_back(micros(Clock::now() - start));
+		}
+		return times;
+	}
+
+	// Nearest-rank percentile, q in (0, 1]
+	double Percentile(std::vector<double> v, double q)
+	{
+		std::sort(v.begin(), v.end());
+		const size_t rank = (size_t)std::ceil(q * (double)v.size());
+		return v[rank ? rank - 1 : 0];
+	}
+
+	void ReportLatency(const Options& opt, BenchReport& out, const std::string& base, const std::vector<double>& us)
+	{
+		if (us.empty()) return;
+		if (Selected(opt, base + "_p50")) Report(out, base + "_p50", "us", Percentile(us, 0.50), false);
+		if (Selected(opt, base + "_p99")) Report(out, base + "_p99", "us", Percentile(us, 0.99), false);
+		if (Selected(opt, base + "_max")) Report(out, base + "_max", "us", Percentile(us, 1.0), false);
+	}
+
+	// Returns false if the session cannot be read or the strategies end with different ciphertexts.
+	bool BenchKeystrokeReplay(const Options& opt, BenchReport& out)
+	{
+		static const char* const names[3] = { "full", "incremental", "background" };
+		static const EditorStrategy strategies[3] = { EditorStrategy::kFullReencrypt, EditorStrategy::kIncremental, EditorStrategy::kBackground };
+		bool any = false;
+		bool selected[3] = {};
+		for (int s = 0; s < 3; ++s)
+		{
+			for (int k = 0; k < EditEvent::kKinds; ++k)
+			{
+				const std::string base = std::string("replay_") + names[s] + "_" + kEventNames[k];
+				for (const char* suffix : { "_p50", "_p99", "_max", "_ready_p50", "_ready_p99", "_ready_max" })
+					selected[s] = selected[s] || Selected(opt, base + suffix);
+			}
+			any = any || selected[s];
+		}
+		if (!any) return true;
+
+		EditSession session;
+		std::string error;
+		if (opt.replayPath.empty())
+			session = SyntheticEditSession(1 << 20, opt.quick ? 4 : 16, 7);
+		else if (!LoadEditSession(opt.replayPath, session, &error))
+		{
+			std::fprintf(stderr, "--replay: %s\n", error.c_str());
+			return false;
+		}
+
+		std::string reference;
+		bool haveReference = false;
+		for (int s = 0; s < 3; ++s)
+		{
+			if (!selected[s]) continue;
+			const ReplayTimes times = Replay(session, strategies[s]);
+			if (haveReference && times.shown != reference)
+			{
+				std::fprintf(stderr, "replay_%s: the ciphertext differs from the other strategies'\n", names[s]);
+				return false;
+			}
+			reference = times.shown;
+			haveReference = true;
+			for (int k = 0; k < EditEvent::kKinds; ++k)
+			{
+				const std::string base = std::string("replay_") + names[s] + "_" + kEventNames[k];
+				ReportLatency(opt, out, base, times.handled[k]);
+				ReportLatency(opt, out, base + "_ready", times.ready[k]);
+			}
+		}
+		return true;
+	}
+
+	bool ParseArgs(int argc, char** argv, Options& opt)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* a = argv[i];
+			const char* v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+			if (std::strcmp(a, "--quick") == 0) { opt.quick = true; opt.bench.minSeconds = 0.05; continue; }
+			if (std::strcmp(a, "--perf") == 0) { opt.perf = true; continue; }
+			if (!v) return false;
+			if (std::strcmp(a, "--filter") == 0) opt.filter = v;
+			else if (std::strcmp(a, "--threads") == 0) opt.maxThreads = (unsigned)std::strtoul(v, nullptr, 10);
+			else if (std::strcmp(a, "--min-time") == 0) opt.bench.minSeconds = std::strtod(v, nullptr);
+			else if (std::strcmp(a, "--reps") == 0) opt.bench.repetitions = (std::max)(1, std::atoi(v));
+			else if (std::strcmp(a, "--out") == 0) opt.outPath = v;
+			else if (std::strcmp(a, "--baseline") == 0) opt.baselinePath = v;
+			else if (std::strcmp(a, "--threshold") == 0) opt.threshold = std::strtod(v, nullptr);
+			else if (std::strcmp(a, "--replay") == 0) opt.replayPath = v;
+			else return false;
+			++i;
+		}
+		if (opt.maxThreads == 0) opt.maxThreads = QueryCpuInfo().hardwareThreads;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options opt;
+	if (!ParseArgs(argc, argv, opt))
+	{
+		std::fprintf(stderr, "usage: EnigmaBench [--quick] [--perf] [--filter SUBSTR] [--threads N] [--min-time S] [--reps R]\n"
+			"                   [--out FILE] [--baseline FILE] [--threshold F] [--replay FILE]\n");
+		return 1;
+	}
+
+	if (opt.perf)
+	{
+		PerfCounters probe(false);
+		if (!probe.available()) std::fprintf(stderr, "--perf: %s; continuing without counters\n", probe.error().c_str());
+	}
+
+	BenchReport results;
+	BenchEncryptChar(opt, results);
+	BenchRotorPass(opt, results);
+	BenchEncrypt(opt, results, "encrypt_1KB", 1 << 10, MakeMachine());
+	BenchEncrypt(opt, results, "encrypt_1MB", 1 << 20, MakeMachine());
+	BenchEncrypt(opt, results, "encrypt_m4_1MB", 1 << 20, MakeMachineM4());
+	BenchEncryptUtf16(opt, results);
+	BenchEncryptStream(opt, results);
+	BenchEngineEncrypt(opt, results);
+	BenchManyKeys(opt, results);
+	BenchConstruct(opt, results);
+	BenchConstructCached(opt, results);
+	BenchPlugboardParse(opt, results);
+	if (!BenchKeystrokeReplay(opt, results))
+		return 1;
+	BenchSearch(opt, results);
+
+	if (!EngineDispatcher::instance().decisions().empty()) results.dispatch = EngineDispatcher::instance().diagnostics();
+	const std::string json = ReportToJson(results);
+	if (opt.outPath.empty())
+	{
+		std::fputs(json.c_str(), stdout);
+	}
+	else
+	{
+		std::ofstream f(opt.outPath.c_str(), std::ios::binary);
+		if (!(f << json))
+		{
+			std::fprintf(stderr, "cannot write %s\n", opt.outPath.c_str());
+			return 1;
+		}
+	}
+
+	if (!opt.baselinePath.empty())
+	{
+		std::vector<BenchResult> baseline;
+		if (!LoadBaseline(opt.baselinePath, baseline))
+		{
+			std::fprintf(stderr, "cannot read baseline %s\n", opt.baselinePath.c_str());
+			return 1;
+		}
+		int regressions = CompareToBaseline(results.results, baseline, opt.threshold);
+		if (regressions > 0)
+		{
+			std::fprintf(stderr, "%d benchmark(s) regressed by more than %.0f%%\n", regressions, opt.threshold * 100.0);
+			return 2;
+		}
+	}
+	return 0;
+}